@@ -0,0 +1,208 @@
+/** @license 2019 Neil Edelman, distributed under the terms of the
+ [MIT License](https://opensource.org/licenses/MIT).
+
+ A region allocator for a report. Memory is bumped off large blocks and is
+ only given back all at once by <fn:Arena_>, or kept for the next report by
+ <fn:ArenaClear>. The last allocation can grow in place, which is the common
+ case for a vector that is being appended. Other frees do nothing. With
+ `DBG_MEMORY`, prints statistics at the end. <fn:ArenaRealloc> and
+ <fn:ArenaFree> have the signature that `Array.h` expects, so they work on the
+ arena that the thread has chosen with <fn:ArenaUse>.
+
+ @std C89, POSIX.1-2001 `getrusage` */
+
+#if defined(__unix__) || defined(__APPLE__)
+#define ARENA_RUSAGE
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L /* getrusage */
+#endif
+#endif
+
+#include <stddef.h> /* size_t */
+#include <stdlib.h> /* malloc free */
+#include <string.h> /* memcpy memset */
+#include <stdio.h>  /* fprintf */
+#include <assert.h> /* assert */
+#include <errno.h>  /* errno ERANGE */
+#ifdef ARENA_RUSAGE /* <-- rusage */
+#include <sys/resource.h> /* getrusage */
+#endif /* rusage --> */
+#include "Cdoc.h"
+#include "ThreadLocal.h"
+#include "Arena.h" /** \include */
+
+/* Allocations are aligned to this. */
+union arena_align { long l; double d; void *p; size_t s; };
+
+/* A header to a block of memory that is allocated from. */
+struct Block {
+	struct Block *prev;
+	size_t capacity, size;
+	union arena_align data[1]; /* Flexible. */
+};
+
+static const size_t arena_block_capacity = 1 << 16;
+
+/* `spare` are blocks that were cleared and can be used again. */
+struct Arena {
+	struct Block *block, *spare;
+	void *last;
+	struct { size_t allocs, in_place, copied, bytes, blocks, block_bytes,
+		recycled; } stats;
+};
+
+/* The arena that this thread allocates from. */
+static THREAD_LOCAL struct Arena *arena;
+
+/** @return `bytes` rounded up to alignment, or zero if it overflows. */
+static size_t align(const size_t bytes) {
+	const size_t a = sizeof(union arena_align);
+	return bytes > (size_t)-1 - (a - 1) ? 0 : (bytes + a - 1) / a * a;
+}
+
+/** @return A spare block that has at least `size`, taken off the list, or
+ null. */
+static struct Block *spare_block(const size_t size) {
+	struct Block **pblock = &arena->spare, *block;
+	while((block = *pblock) && block->capacity < size) pblock = &block->prev;
+	if(block) *pblock = block->prev, arena->stats.recycled++;
+	return block;
+}
+
+/** @return A new allocation of at least `bytes` at the end of the arena.
+ @throws[malloc, ERANGE] */
+static void *arena_alloc(const size_t bytes) {
+	struct Block *block = arena->block;
+	const size_t size = align(bytes);
+	void *data;
+	if(!size) { errno = ERANGE; return 0; }
+	if(!block || block->capacity - block->size < size) {
+		if(!(block = spare_block(size))) {
+			const size_t capacity = size > arena_block_capacity
+				? size : arena_block_capacity;
+			if(capacity > (size_t)-1 - sizeof *block
+				|| !(block = malloc(sizeof *block + capacity)))
+				{ if(!errno) errno = ERANGE; return 0; }
+			block->capacity = capacity;
+			arena->stats.blocks++;
+			arena->stats.block_bytes += capacity;
+		}
+		block->prev = arena->block;
+		block->size = 0;
+		arena->block = block;
+	}
+	data = (char *)block->data + block->size;
+	block->size += size;
+	arena->last = data;
+	arena->stats.allocs++;
+	arena->stats.bytes += size;
+	return data;
+}
+
+/** Prints the statistics of `a` and the process to `CdocGetErr()`. */
+static void arena_debug(const struct Arena *const a) {
+#ifdef ARENA_RUSAGE /* <-- rusage */
+	struct rusage r;
+#endif /* rusage --> */
+	fprintf(CdocGetErr(), "Arena: %lu allocations (%lu grew in place, "
+		"%lu copied) of %lu bytes in %lu blocks of %lu bytes, (%lu recycled.)\n",
+		(unsigned long)a->stats.allocs,
+		(unsigned long)a->stats.in_place,
+		(unsigned long)a->stats.copied,
+		(unsigned long)a->stats.bytes,
+		(unsigned long)a->stats.blocks,
+		(unsigned long)a->stats.block_bytes,
+		(unsigned long)a->stats.recycled);
+#ifdef ARENA_RUSAGE /* <-- rusage */
+	/* `ru_maxrss` is kilobytes on Linux and bytes on MacOS. */
+	if(!getrusage(RUSAGE_SELF, &r)) fprintf(CdocGetErr(),
+		"Peak resident set size: %ld%s.\n", (long)r.ru_maxrss,
+#ifdef __APPLE__
+		" bytes"
+#else
+		" kilobytes"
+#endif
+		);
+#endif /* rusage --> */
+}
+
+/** Frees all the memory in `*parena` at once, and the arena. If it was in use
+ by this thread, it isn't any more. */
+void Arena_(struct Arena **const parena) {
+	struct Arena *a;
+	struct Block *block;
+	if(!parena || !(a = *parena)) return;
+	if(CdocGetDebug() & DBG_MEMORY) arena_debug(a);
+	while((block = a->block)) a->block = block->prev, free(block);
+	while((block = a->spare)) a->spare = block->prev, free(block);
+	if(arena == a) arena = 0;
+	free(a);
+	*parena = 0;
+}
+
+/** @return A new empty arena that must be passed to <fn:Arena_>, or null.
+ @throws[malloc] */
+struct Arena *Arena(void) {
+	struct Arena *a;
+	if(!(a = malloc(sizeof *a))) return 0;
+	a->block = a->spare = 0;
+	a->last = 0;
+	memset(&a->stats, 0, sizeof a->stats);
+	return a;
+}
+
+/** Invalidates all the memory in `a`, but keeps the blocks to allocate from
+ again. */
+void ArenaClear(struct Arena *const a) {
+	struct Block *block;
+	assert(a);
+	while((block = a->block)) a->block = block->prev,
+		block->prev = a->spare, a->spare = block;
+	a->last = 0;
+}
+
+/** Sets the arena that this thread allocates from to `a`, which can be null.
+ @return The arena that was in use. */
+struct Arena *ArenaUse(struct Arena *const a) {
+	struct Arena *const previous = arena;
+	arena = a;
+	return previous;
+}
+
+/** Implements `realloc` for the arena; the old memory is only re-used if
+ `data` was the last thing allocated.
+ @param[data] Null or memory from the arena, that has `old_bytes`.
+ @return Memory of `new_bytes` with the contents of `data`, or null.
+ @throws[malloc, ERANGE] */
+void *ArenaRealloc(void *const data, const size_t old_bytes,
+	const size_t new_bytes) {
+	void *copy;
+	assert(arena && !data == !old_bytes);
+	if(data && data == arena->last) {
+		struct Block *const block = arena->block;
+		const size_t old_size = align(old_bytes), new_size = align(new_bytes);
+		assert(block && old_size <= block->size);
+		if(new_size >= old_size
+			&& new_size - old_size <= block->capacity - block->size) {
+			block->size += new_size - old_size;
+			arena->stats.in_place++;
+			arena->stats.bytes += new_size - old_size;
+			return data;
+		}
+	}
+	if(!(copy = arena_alloc(new_bytes))) return 0;
+	if(data) memcpy(copy, data, old_bytes < new_bytes ? old_bytes : new_bytes),
+		arena->stats.copied++;
+	return copy;
+}
+
+/** Implements `free` for the arena; only the last allocation is re-used. */
+void ArenaFree(void *const data, const size_t bytes) {
+	struct Block *block;
+	assert(arena);
+	if(!data || data != arena->last) return;
+	block = arena->block;
+	assert(block && align(bytes) <= block->size);
+	block->size -= align(bytes);
+	arena->last = 0;
+}
@@ -0,0 +1,9 @@
+struct Arena;
+
+void Arena_(struct Arena **const parena);
+struct Arena *Arena(void);
+void ArenaClear(struct Arena *const a);
+struct Arena *ArenaUse(struct Arena *const a);
+void *ArenaRealloc(void *const data, const size_t old_bytes,
+	const size_t new_bytes);
+void ArenaFree(void *const data, const size_t bytes);
@@ -24,6 +24,11 @@
  @param[ARRAY_STACK]
  Doesn't define removal functions except <fn:<T>ArrayPop>, making it a stack.
 
+ @param[ARRAY_REALLOC, ARRAY_FREE]
+ Optional allocator used instead of `realloc` and `free`; both or neither.
+ `ARRAY_REALLOC(data, old_bytes, new_bytes)` and `ARRAY_FREE(data, bytes)`
+ are given the sizes of the blocks, which is useful for a region allocator.
+
  @param[ARRAY_TO_STRING]
  Optional print function implementing <typedef:<PT>ToString>; makes available
  <fn:<T>ArrayToString>.
@@ -60,6 +65,9 @@
 	|| defined(ARRAY_TEST)) /* <!-- error */
 #error With ARRAY_CHILD, defining public interface functions is useless.
 #endif /* error --> */
+#if defined(ARRAY_REALLOC) != defined(ARRAY_FREE) /* <!-- error */
+#error ARRAY_REALLOC and ARRAY_FREE go together.
+#endif /* error --> */
 #if defined(T) || defined(T_) || defined(PT_) /* <!-- error */
 #error T, T_, and PT_ cannot be defined.
 #endif /* error --> */
@@ -83,6 +91,10 @@
 #define PCAT(x, y) PCAT_(x, y)
 #define T_(thing) CAT(ARRAY_NAME, thing)
 #define PT_(thing) PCAT(array, PCAT(ARRAY_NAME, thing))
+#ifndef ARRAY_REALLOC /* <!-- std */
+#define ARRAY_REALLOC(data, old_bytes, new_bytes) realloc(data, new_bytes)
+#define ARRAY_FREE(data, bytes) free(data)
+#endif /* std --> */
 
 /** A valid tag type set by `ARRAY_TYPE`. This becomes `T`. */
 typedef ARRAY_TYPE PT_(Type);
@@ -144,7 +156,8 @@ static int PT_(reserve)(struct T_(Array) *const a,
 		size_t temp = c0 + c1; c0 = c1; c1 = temp;
 		if(c1 > max_size || c1 < c0) c1 = max_size;
 	}
-	if(!(data = realloc(a->data, c0 * sizeof *a->data)))
+	if(!(data = ARRAY_REALLOC(a->data, a->capacity * sizeof *a->data,
+		c0 * sizeof *a->data)))
 		{ if(!errno) errno = ERANGE; return 0; }
 	if(update_ptr && a->data != data)
 		*update_ptr = data + (*update_ptr - a->data);
@@ -226,7 +239,7 @@ static void PT_(array)(struct T_(Array) *const a) {
  @allow */
 static void T_(Array_)(struct T_(Array) *const a) {
 	if(!a) return;
-	free(a->data);
+	ARRAY_FREE(a->data, a->capacity * sizeof *a->data);
 	PT_(array)(a);
 }
 
@@ -617,8 +630,13 @@ static const PT_(ToString) PT_(to_string) = (ARRAY_TO_STRING);
  @order \Theta(1); it has a 255 character limit; every element takes some of it.
  @allow */
 static const char *T_(ArrayToString)(const struct T_(Array) *const a) {
+#ifdef THREAD_LOCAL /* <!-- thread */
+	static THREAD_LOCAL char buffers[4][256];
+	static THREAD_LOCAL size_t buffer_i;
+#else /* thread --><!-- !thread */
 	static char buffers[4][256];
 	static size_t buffer_i;
+#endif /* !thread --> */
 	char *const buffer = buffers[buffer_i++], *b = buffer;
 	const size_t buffers_no = sizeof buffers / sizeof *buffers,
 		buffer_size = sizeof *buffers / sizeof **buffers;
@@ -727,6 +745,8 @@ static void PT_(unused_coda)(void) { PT_(unused_set)(); }
 #undef PT_
 #undef ARRAY_NAME
 #undef ARRAY_TYPE
+#undef ARRAY_REALLOC
+#undef ARRAY_FREE
 #ifdef ARRAY_STACK
 #undef ARRAY_STACK
 #endif
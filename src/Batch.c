@@ -0,0 +1,201 @@
+/** @license 2019 Neil Edelman, distributed under the terms of the
+ [MIT License](https://opensource.org/licenses/MIT).
+
+ Runs independent jobs on a pool of threads and collects them in order. Every
+ worker has a deque, a range of jobs, that starts out as an equal share. The
+ owner takes jobs off the front; a worker that runs out steals the back half
+ of another's, so the lowest jobs, which the caller is waiting on, are done
+ first. The deques are locked; the ranges are so cheap to split that there
+ is hardly any contention. Without `pthread`, or where thread-local storage is
+ not separate, the jobs are done one after the other on the calling thread.
+
+ @std C89, POSIX.1-2001 `pthread` */
+
+#if defined(__unix__) || defined(__APPLE__)
+#define BATCH_PTHREAD
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L /* pthread */
+#endif
+#endif
+
+#include <stdlib.h> /* malloc free */
+#include <string.h> /* memset */
+#include <assert.h> /* assert */
+#include <errno.h>  /* errno */
+#include "ThreadLocal.h"
+#ifndef THREAD_LOCAL_SEPARATE
+#undef BATCH_PTHREAD /* The threads would share the modules' state. */
+#endif
+#ifdef BATCH_PTHREAD /* <-- pthread */
+#include <pthread.h>
+#endif /* pthread --> */
+#include "Batch.h" /** \include */
+
+/** Does the jobs in order on this thread. @return Whether they were all
+ collected. */
+static int batch_serial(const struct BatchWork *const work, const size_t no) {
+	size_t i;
+	for(i = 0; i < no; i++)
+		if(!work->collect(i, work->job(i, work->param), work->param)) return 0;
+	return 1;
+}
+
+#ifdef BATCH_PTHREAD /* <-- pthread */
+
+/** The jobs `[top, bottom)` are waiting. */
+struct Deque {
+	pthread_mutex_t lock;
+	size_t top, bottom;
+};
+
+enum Status { PENDING, SUCCEEDED, FAILED };
+
+struct Batch;
+
+struct Worker {
+	struct Batch *batch;
+	struct Deque deque;
+	pthread_t thread;
+};
+
+/* `status` of each job and `is_stop` are guarded by `lock`; `done` is
+ signalled when a job finishes. */
+struct Batch {
+	const struct BatchWork *work;
+	struct Worker *workers;
+	size_t workers_no;
+	pthread_mutex_t lock;
+	pthread_cond_t done;
+	unsigned char *status;
+	int is_stop;
+};
+
+/** @return Takes the next job off the front of `deque` into `i`. */
+static int deque_pop(struct Deque *const deque, size_t *const i) {
+	int is = 0;
+	pthread_mutex_lock(&deque->lock);
+	if(deque->top < deque->bottom) *i = deque->top++, is = 1;
+	pthread_mutex_unlock(&deque->lock);
+	return is;
+}
+
+/** Moves the back half of another worker's jobs to `w`.
+ @return Whether there were any left anywhere. */
+static int steal(struct Worker *const w) {
+	const struct Batch *const b = w->batch;
+	const size_t self = (size_t)(w - b->workers);
+	size_t n;
+	for(n = 1; n < b->workers_no; n++) {
+		struct Deque *const victim
+			= &b->workers[(self + n) % b->workers_no].deque;
+		size_t take, bottom;
+		pthread_mutex_lock(&victim->lock);
+		take = (victim->bottom - victim->top + 1) / 2;
+		bottom = victim->bottom;
+		victim->bottom -= take;
+		pthread_mutex_unlock(&victim->lock);
+		if(!take) continue;
+		pthread_mutex_lock(&w->deque.lock);
+		w->deque.top = bottom - take, w->deque.bottom = bottom;
+		pthread_mutex_unlock(&w->deque.lock);
+		return 1;
+	}
+	return 0;
+}
+
+/** Does jobs until there are none or the batch is stopped. Implements
+ `pthread_create`. */
+static void *run(void *const param) {
+	struct Worker *const w = param;
+	struct Batch *const b = w->batch;
+	size_t i;
+	int is_stop = 0;
+	while(!is_stop && (deque_pop(&w->deque, &i) || (steal(w)
+		&& deque_pop(&w->deque, &i)))) {
+		const int success = b->work->job(i, b->work->param);
+		pthread_mutex_lock(&b->lock);
+		b->status[i] = success ? SUCCEEDED : FAILED;
+		is_stop = b->is_stop;
+		pthread_cond_broadcast(&b->done);
+		pthread_mutex_unlock(&b->lock);
+	}
+	if(b->work->end) b->work->end(b->work->param);
+	return 0;
+}
+
+/** Collects the jobs in `b` in order, and stops on the first that isn't.
+ @return Whether they were all collected. */
+static int collect(struct Batch *const b, const size_t no) {
+	size_t i;
+	for(i = 0; i < no; i++) {
+		int success;
+		pthread_mutex_lock(&b->lock);
+		while(b->status[i] == PENDING) pthread_cond_wait(&b->done, &b->lock);
+		success = b->status[i] == SUCCEEDED;
+		pthread_mutex_unlock(&b->lock);
+		if(b->work->collect(i, success, b->work->param)) continue;
+		pthread_mutex_lock(&b->lock);
+		b->is_stop = 1;
+		pthread_mutex_unlock(&b->lock);
+		return 0;
+	}
+	return 1;
+}
+
+#endif /* pthread --> */
+
+/** Runs `no` jobs of `work` on up to `threads` threads. The calling thread
+ only collects; if there is one thread, or threads are not available, it does
+ the jobs itself and `end` is not called.
+ @return Whether every job was collected; false if `collect` returned false.
+ @throws[malloc, pthread_mutex_init, pthread_cond_init] */
+int BatchRun(const struct BatchWork *const work, const size_t no,
+	const unsigned threads) {
+#ifdef BATCH_PTHREAD /* <-- pthread */
+	struct Batch b;
+	size_t i, created = 0;
+	int success = 0, e;
+#endif /* pthread --> */
+	assert(work && work->job && work->collect);
+#ifndef BATCH_PTHREAD /* <-- !pthread */
+	(void)threads;
+	return batch_serial(work, no);
+#else /* !pthread --><-- pthread */
+	if(threads <= 1 || no <= 1) return batch_serial(work, no);
+	b.work = work;
+	b.workers_no = threads < no ? threads : no;
+	b.is_stop = 0;
+	b.workers = 0, b.status = 0;
+	if((e = pthread_mutex_init(&b.lock, 0))) { errno = e; return 0; }
+	if((e = pthread_cond_init(&b.done, 0))) { errno = e; goto lock; }
+	if(!(b.workers = malloc(sizeof *b.workers * b.workers_no))
+		|| !(b.status = malloc(no))) goto catch;
+	memset(b.status, PENDING, no);
+	/* Equal shares; a worker that can't start will be stolen from. */
+	for(i = 0; i < b.workers_no; i++) {
+		struct Worker *const w = b.workers + i;
+		w->batch = &b;
+		w->deque.top = no * i / b.workers_no;
+		w->deque.bottom = no * (i + 1) / b.workers_no;
+		if((e = pthread_mutex_init(&w->deque.lock, 0))) { errno = e;
+			b.workers_no = i; goto catch; }
+	}
+	for(i = 0; i < b.workers_no; i++, created++)
+		if((e = pthread_create(&b.workers[i].thread, 0, &run,
+			b.workers + i))) { errno = e; break; }
+	success = created ? collect(&b, no) : batch_serial(work, no);
+	goto finally;
+catch:
+	b.is_stop = 1;
+finally:
+	for(i = 0; i < created; i++) pthread_join(b.workers[i].thread, 0);
+	if(b.workers) for(i = 0; i < b.workers_no; i++)
+		pthread_mutex_destroy(&b.workers[i].deque.lock);
+	free(b.workers);
+	free(b.status);
+	pthread_cond_destroy(&b.done);
+lock:
+	pthread_mutex_destroy(&b.lock);
+	return success;
+#endif /* pthread --> */
+}
@@ -0,0 +1,14 @@
+/** What to do with every job; `end` is optional. */
+struct BatchWork {
+	/** Does job `i` on any thread. @return Success. */
+	int (*job)(const size_t i, void *const param);
+	/** Called on the calling thread in order of `i`, when it's done.
+	 @return Whether to go on. */
+	int (*collect)(const size_t i, const int success, void *const param);
+	/** Called on a worker thread when it's finished all it's jobs. */
+	void (*end)(void *const param);
+	void *param;
+};
+
+int BatchRun(const struct BatchWork *const work, const size_t no,
+	const unsigned threads);
@@ -1,7 +1,7 @@
 /** @license 2017 Neil Edelman, distributed under the terms of the
  [MIT License](https://opensource.org/licenses/MIT).
 
- This provides a space to store temporary strings.
+ This provides a space to store temporary strings, two per thread.
 
  @std C89 */
 
@@ -9,18 +9,22 @@
 #include <assert.h> /* assert */
 #include "Division.h"
 #include "Cdoc.h"
-#include "Buffer.h"
+#include "ThreadLocal.h"
+#include "Buffer.h" /** \include */
 
 #define ARRAY_NAME Char
 #define ARRAY_TYPE char
 #include "Array.h"
 
-static struct CharArray buffers[2], *buffer = buffers;
+static THREAD_LOCAL struct CharArray buffers[2];
+static THREAD_LOCAL int current;
+#define buffer (buffers + current)
 
-/** Destructor for the buffers. */
+/** Destructor for the buffers of this thread. */
 void Buffer_(void) {
 	CharArray_(buffers + 0);
 	CharArray_(buffers + 1);
+	current = 0;
 }
 
 /** Get the buffer. Always return a string. */
@@ -52,5 +56,5 @@ char *BufferPrepare(const size_t length) {
 
 /** Switch the buffers so one can compare the two. */
 void BufferSwap(void) {
-	buffer = buffers + !(int)(buffer - buffers);
+	current = !current;
 }
@@ -0,0 +1,251 @@
+/** @license 2019 Neil Edelman, distributed under the terms of the
+ [MIT License](https://opensource.org/licenses/MIT).
+
+ Keeps what the inputs were parsed into in a directory, so that another run
+ doesn't have to scan them again. Every input has a file that is named after
+ the hash of it's name and the options that change the parse; it starts with
+ the magic, the version, the options, and the name, so a collision, or an old
+ layout, is a miss. What comes after that is up to `Report.c`, which checks
+ that the input and it's includes have the same contents. The file is mapped
+ in one piece, and it's written next to it, with the process in the name, and
+ renamed over, so runs can share the directory. All of the numbers are 32-bit
+ little-endian, and the hash is 32-bit FNV-1a.
+
+ @std C89, POSIX.1-2001 `mmap` `mkdir` `getpid` */
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CACHE_POSIX
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L /* open fstat mmap mkdir getpid */
+#endif
+#endif
+
+#include <stddef.h> /* size_t */
+#include <stdio.h>  /* FILE fopen fread fwrite rename remove sprintf */
+#include <string.h> /* strlen memcmp memcpy */
+#include <assert.h> /* assert */
+#include <errno.h>  /* errno ENOENT EEXIST */
+#ifdef CACHE_POSIX /* <-- posix */
+#include <sys/types.h> /* off_t */
+#include <sys/stat.h>  /* fstat mkdir */
+#include <sys/mman.h>  /* mmap munmap */
+#include <fcntl.h>     /* open */
+#include <unistd.h>    /* close getpid */
+#endif /* posix --> */
+#include "ThreadLocal.h"
+#include "Path.h" /* `path_dirsep` */
+#include "Cache.h" /** \include */
+
+#define ARRAY_NAME Char
+#define ARRAY_TYPE char
+#include "Array.h"
+
+#define ARRAY_NAME Byte
+#define ARRAY_TYPE unsigned char
+#include "Array.h"
+
+/* Change this when the layout changes. */
+static const char cache_magic[8] = { 'c', 'd', 'o', 'c', 'r', 'e', 'p', 0 };
+static const unsigned long cache_version = 2;
+
+/* The header is the magic, the version, the options, and the size of the
+ name, with the null, that comes next. */
+#define CACHE_HEADER 20
+
+#define CACHE_FNV_BASIS 0x811c9dc5UL
+#define CACHE_FNV_PRIME 0x01000193UL
+
+/* The file of the last <fn:CacheLoad> on this thread, `fn`, is `size` of
+ `data`, which is `map`, or `read`. `temp` is the name that's written. */
+static THREAD_LOCAL struct {
+	struct CharArray fn, temp;
+	void *map;
+	struct ByteArray read;
+	const unsigned char *data;
+	size_t size;
+} cache;
+
+/** @return The 32-bit little-endian number at `b`. */
+static unsigned long get32(const unsigned char *const b) {
+	return (unsigned long)b[0] | (unsigned long)b[1] << 8
+		| (unsigned long)b[2] << 16 | (unsigned long)b[3] << 24;
+}
+
+/** Puts `x` at `b` as a 32-bit little-endian number. */
+static void put32(unsigned char *const b, const unsigned long x) {
+	b[0] = (unsigned char)(x & 0xff), b[1] = (unsigned char)(x >> 8 & 0xff);
+	b[2] = (unsigned char)(x >> 16 & 0xff);
+	b[3] = (unsigned char)(x >> 24 & 0xff);
+}
+
+/** @return Continues the hash `h` with `size` bytes of `data`. */
+static unsigned long fnv(unsigned long h, const void *const data,
+	const size_t size) {
+	const unsigned char *d = data, *const end = d + size;
+	while(d < end) h = ((h ^ *d++) * CACHE_FNV_PRIME) & 0xffffffffUL;
+	return h;
+}
+
+/** @return The hash of `size` bytes of `data`; it's the same on every
+ platform. */
+unsigned long CacheHash(const void *const data, const size_t size) {
+	return fnv(CACHE_FNV_BASIS, data, size);
+}
+
+/** Forgets the last file. */
+static void unload(void) {
+#ifdef CACHE_POSIX
+	if(cache.map) munmap(cache.map, cache.size);
+#endif
+	cache.map = 0, cache.data = 0, cache.size = 0;
+	ByteArrayClear(&cache.read);
+}
+
+/** Destructor for the cache of this thread. */
+void Cache_(void) {
+	unload();
+	CharArray_(&cache.fn);
+	CharArray_(&cache.temp);
+	ByteArray_(&cache.read);
+}
+
+/** Puts the name of the file of `in_fn` with `flags` in `dir` in `fn`.
+ @return Success. @throws[realloc] */
+static int name(const char *const dir, const char *const in_fn,
+	const unsigned flags) {
+	const size_t dir_len = strlen(dir);
+	const size_t sep = dir_len && dir[dir_len - 1] != *path_dirsep;
+	unsigned char f[4];
+	char *c;
+	put32(f, flags);
+	CharArrayClear(&cache.fn);
+	if(!(c = CharArrayBuffer(&cache.fn, dir_len + sep
+		+ sizeof "01234567.cdoc"))) return 0;
+	memcpy(c, dir, dir_len);
+	if(sep) c[dir_len] = *path_dirsep;
+	sprintf(c + dir_len + sep, "%08lx.cdoc",
+		fnv(fnv(CACHE_FNV_BASIS, in_fn, strlen(in_fn) + 1), f, sizeof f));
+	return 1;
+}
+
+/** Maps or reads `fn`. @return Whether it's there.
+ @throws[fopen, fread, realloc] */
+static int map(const char *const fn) {
+	const size_t granularity = 4096;
+	FILE *fp;
+	unsigned char *read_here;
+	size_t nread;
+	int success = 0;
+#ifdef CACHE_POSIX /* <-- posix */
+	struct stat st;
+	void *m;
+	int fd;
+	if((fd = open(fn, O_RDONLY)) != -1) {
+		if(fstat(fd, &st) != -1 && S_ISREG(st.st_mode) && st.st_size > 0
+			&& (off_t)(size_t)st.st_size == st.st_size
+			&& (m = mmap(0, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd,
+			0)) != MAP_FAILED) {
+			close(fd);
+			cache.map = m;
+			cache.data = m, cache.size = (size_t)st.st_size;
+			return 1;
+		}
+		close(fd);
+	}
+#endif /* posix --> */
+	if(!(fp = fopen(fn, "rb"))) return 0;
+	do {
+		if(!(read_here = ByteArrayReserve(&cache.read, granularity))
+			|| (nread = fread(read_here, 1, granularity, fp), ferror(fp))
+			|| (nread && !ByteArrayBuffer(&cache.read, nread)))
+			goto finally;
+	} while(nread == granularity);
+	cache.data = ByteArrayGet(&cache.read);
+	cache.size = ByteArraySize(&cache.read);
+	success = 1;
+finally:
+	fclose(fp);
+	return success;
+}
+
+/** Loads what was stored for `in_fn` parsed with `flags` in `dir`. It's valid
+ until the next <fn:CacheLoad> or <fn:Cache_> on this thread.
+ @param[size] Set to the size of what was stored.
+ @return What was stored, or null if there's nothing; if there was an error,
+ `errno` is set. @throws[realloc, open, fopen, fread] */
+const unsigned char *CacheLoad(const char *const dir, const char *const in_fn,
+	const unsigned flags, size_t *const size) {
+	const size_t in_size = strlen(in_fn) + 1;
+	const unsigned char *d;
+	assert(dir && in_fn && size);
+	unload();
+	if(!name(dir, in_fn, flags)) return 0;
+	if(!map(CharArrayGet(&cache.fn))) {
+		if(errno == ENOENT) errno = 0;
+		return 0;
+	}
+	d = cache.data;
+	if(cache.size < CACHE_HEADER
+		|| memcmp(d, cache_magic, sizeof cache_magic)
+		|| get32(d + 8) != cache_version
+		|| get32(d + 12) != (flags & 0xffffffffUL)
+		|| get32(d + 16) != in_size
+		|| cache.size - CACHE_HEADER < in_size
+		|| memcmp(d + CACHE_HEADER, in_fn, in_size))
+		{ unload(); errno = 0; return 0; }
+	*size = cache.size - CACHE_HEADER - in_size;
+	return d + CACHE_HEADER + in_size;
+}
+
+/** Stores `size` of `data` for `in_fn` parsed with `flags` in `dir`, which is
+ made if it's not there. It's written next to the file, in a name that has the
+ process where there is one, and renamed over it, so it's never half-written,
+ even if another run is storing the same file.
+ @return Success. @throws[realloc, mkdir, fopen, fwrite, rename]
+ @throws[ERANGE] The name is too long for 32 bits. */
+int CacheStore(const char *const dir, const char *const in_fn,
+	const unsigned flags, const unsigned char *const data, const size_t size) {
+	const size_t in_size = strlen(in_fn) + 1;
+	unsigned char header[CACHE_HEADER];
+	const char *fn;
+	size_t fn_len;
+	FILE *fp = 0;
+	char *t;
+	int success = 0;
+	assert(dir && in_fn && (data || !size));
+	if(in_size > 0xffffffffUL) return errno = ERANGE, 0;
+	if(!name(dir, in_fn, flags)) return 0;
+	fn = CharArrayGet(&cache.fn), fn_len = CharArraySize(&cache.fn) - 1;
+	CharArrayClear(&cache.temp);
+	if(!(t = CharArrayBuffer(&cache.temp, fn_len + sizeof ".4294967295.tmp")))
+		return 0;
+	memcpy(t, fn, fn_len);
+#ifdef CACHE_POSIX
+	sprintf(t + fn_len, ".%lu.tmp", (unsigned long)getpid() & 0xffffffffUL);
+#else
+	memcpy(t + fn_len, ".tmp", sizeof ".tmp");
+#endif
+	memcpy(header, cache_magic, sizeof cache_magic);
+	put32(header + 8, cache_version), put32(header + 12, flags);
+	put32(header + 16, in_size);
+	fp = fopen(t, "wb");
+#ifdef CACHE_POSIX
+	/* The first time, the directory might not be there. */
+	if(!fp && errno == ENOENT && (!mkdir(dir, 0777) || errno == EEXIST))
+		fp = fopen(t, "wb");
+#endif
+	if(!fp) goto finally;
+	if(fwrite(header, 1, sizeof header, fp) != sizeof header
+		|| fwrite(in_fn, 1, in_size, fp) != in_size
+		|| (size && fwrite(data, 1, size, fp) != size)) goto finally;
+	if(fclose(fp) == EOF) { fp = 0; goto finally; }
+	fp = 0;
+#ifndef CACHE_POSIX
+	remove(fn); /* `rename` may not replace. */
+#endif
+	if(rename(t, fn)) goto finally;
+	success = 1;
+finally:
+	if(fp) fclose(fp);
+	return success;
+}
@@ -0,0 +1,6 @@
+void Cache_(void);
+unsigned long CacheHash(const void *const data, const size_t size);
+const unsigned char *CacheLoad(const char *const dir, const char *const in_fn,
+	const unsigned flags, size_t *const size);
+int CacheStore(const char *const dir, const char *const in_fn,
+	const unsigned flags, const unsigned char *const data, const size_t size);
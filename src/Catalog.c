@@ -0,0 +1,504 @@
+/** @license 2019 Neil Edelman, distributed under the terms of the
+ [MIT License](https://opensource.org/licenses/MIT).
+
+ The catalog of documented symbols of all the outputs of a project, so that
+ links can go from one output to another. Every run reads the catalog that
+ the last run left, which it only uses to look up, and writes a new one with
+ the symbols of the outputs that it made, and the symbols of the others that
+ it didn't. Links are resolved against the last run, so the output doesn't
+ depend on the order that the inputs were done in.
+
+ The file is mapped read-only and looked up in place, in \O(1) on average:
+ a header, a table of `buckets` that are an entry plus one, or zero, in open
+ addressing, the `entries`, and the `strings` that they refer to. All of the
+ numbers are 32-bit little-endian, so it can be shared.
+
+ @std C89, POSIX.1-2001 `mmap` `pthread` */
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CATALOG_POSIX
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L /* open fstat mmap pthread */
+#endif
+#endif
+
+#include <stddef.h> /* size_t */
+#include <stdlib.h> /* qsort bsearch */
+#include <stdio.h>  /* FILE fopen fread fwrite rename remove sprintf */
+#include <string.h> /* strlen strcmp memcmp memcpy memset */
+#include <assert.h> /* assert */
+#include <errno.h>  /* errno */
+#ifdef CATALOG_POSIX /* <-- posix */
+#include <sys/types.h> /* off_t */
+#include <sys/stat.h>  /* fstat */
+#include <sys/mman.h>  /* mmap munmap */
+#include <fcntl.h>     /* open */
+#include <unistd.h>    /* close getpid */
+#include <pthread.h>   /* pthread_mutex */
+#endif /* posix --> */
+#include "Catalog.h" /** \include */
+
+#define ARRAY_NAME Char
+#define ARRAY_TYPE char
+#include "Array.h"
+
+#define ARRAY_NAME Byte
+#define ARRAY_TYPE unsigned char
+#include "Array.h"
+
+#define ARRAY_NAME Size
+#define ARRAY_TYPE size_t
+#include "Array.h"
+
+#define ARRAY_NAME Name
+#define ARRAY_TYPE const char *
+#include "Array.h"
+
+/* Change this when the layout changes. */
+static const char catalog_magic[8] = { 'c', 'd', 'o', 'c', 's', 'y', 'm', 0 };
+static const unsigned long catalog_version = 1;
+
+/* The header is the magic, the version, and the numbers of entries, buckets,
+ and bytes of strings. Every entry is the hash, division and whether it's in
+ HTML, label, output, source, and line. */
+#define CATALOG_HEADER 24
+#define CATALOG_ENTRY 24
+
+/** A symbol that will be written; the strings are offsets in `strings`. */
+struct Entry {
+	unsigned long hash, line;
+	unsigned division;
+	int is_html;
+	size_t label, output, source;
+};
+
+#define ARRAY_NAME Entry
+#define ARRAY_TYPE struct Entry
+#include "Array.h"
+
+/* The last catalog, `fn`, is `size` of `data`, which is `map`, or `read`. The
+ new one is `next` with `next_strings`, of which the outputs and sources are
+ `interned`, an open-addressing table of one plus the offset, or zero, of the
+ `interned_no` in `interned_offsets`. `redone` are the outputs whose symbols in
+ the last one are not kept. The new one is under `lock`. */
+static struct {
+	int is_open;
+	struct CharArray fn;
+	void *map;
+	struct ByteArray read;
+	const unsigned char *data;
+	size_t size;
+	unsigned long entries_no, buckets_no, strings_size;
+	const unsigned char *buckets, *entries;
+	const char *strings;
+	struct EntryArray next;
+	struct CharArray next_strings, redone;
+	struct SizeArray interned, interned_offsets;
+} catalog;
+#ifdef CATALOG_POSIX /* <-- posix */
+static pthread_mutex_t catalog_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif /* posix --> */
+
+/** @return The 32-bit little-endian number at `b`. */
+static unsigned long get32(const unsigned char *const b) {
+	return (unsigned long)b[0] | (unsigned long)b[1] << 8
+		| (unsigned long)b[2] << 16 | (unsigned long)b[3] << 24;
+}
+
+/** Puts `x` at `b` as a 32-bit little-endian number. */
+static void put32(unsigned char *const b, const unsigned long x) {
+	b[0] = (unsigned char)(x & 0xff), b[1] = (unsigned char)(x >> 8 & 0xff);
+	b[2] = (unsigned char)(x >> 16 & 0xff);
+	b[3] = (unsigned char)(x >> 24 & 0xff);
+}
+
+/** @return The first bucket for `division` and `hash` under `mask`. */
+static unsigned long bucket(const unsigned division, const unsigned long hash,
+	const unsigned long mask) {
+	return (hash + division) & mask;
+}
+
+/** Forgets the catalog of the last run. */
+static void unload(void) {
+#ifdef CATALOG_POSIX
+	if(catalog.map) munmap(catalog.map, catalog.size);
+#endif
+	catalog.map = 0, catalog.data = 0, catalog.size = 0;
+	catalog.entries_no = catalog.buckets_no = catalog.strings_size = 0;
+	catalog.buckets = catalog.entries = 0, catalog.strings = 0;
+	ByteArrayClear(&catalog.read);
+}
+
+/** Destructor for the catalog. */
+void Catalog_(void) {
+	unload();
+	CharArray_(&catalog.fn);
+	ByteArray_(&catalog.read);
+	EntryArray_(&catalog.next);
+	CharArray_(&catalog.next_strings);
+	CharArray_(&catalog.redone);
+	SizeArray_(&catalog.interned);
+	SizeArray_(&catalog.interned_offsets);
+	catalog.is_open = 0;
+}
+
+/** Maps or reads `fn` into the catalog. @return Whether it's there.
+ @throws[fopen, fread, realloc] */
+static int map_catalog(const char *const fn) {
+	const size_t granularity = 4096;
+	FILE *fp;
+	unsigned char *read_here;
+	size_t nread;
+	int success = 0;
+#ifdef CATALOG_POSIX /* <-- posix */
+	struct stat st;
+	void *map;
+	int fd;
+	if((fd = open(fn, O_RDONLY)) != -1) {
+		if(fstat(fd, &st) != -1 && S_ISREG(st.st_mode) && st.st_size > 0
+			&& (off_t)(size_t)st.st_size == st.st_size
+			&& (map = mmap(0, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd,
+			0)) != MAP_FAILED) {
+			close(fd);
+			catalog.map = map;
+			catalog.data = map, catalog.size = (size_t)st.st_size;
+			return 1;
+		}
+		close(fd);
+	}
+#endif /* posix --> */
+	if(!(fp = fopen(fn, "rb"))) return 0;
+	do {
+		if(!(read_here = ByteArrayReserve(&catalog.read, granularity))
+			|| (nread = fread(read_here, 1, granularity, fp), ferror(fp))
+			|| (nread && !ByteArrayBuffer(&catalog.read, nread)))
+			goto finally;
+	} while(nread == granularity);
+	catalog.data = ByteArrayGet(&catalog.read);
+	catalog.size = ByteArraySize(&catalog.read);
+	success = 1;
+finally:
+	fclose(fp);
+	return success;
+}
+
+/** @return Whether the loaded catalog is one that we can read; if so, it's
+ set up. */
+static int check(void) {
+	const unsigned char *const d = catalog.data;
+	unsigned long n, b, s, i;
+	if(catalog.size < CATALOG_HEADER
+		|| memcmp(d, catalog_magic, sizeof catalog_magic)
+		|| get32(d + 8) != catalog_version) return 0;
+	n = get32(d + 12), b = get32(d + 16), s = get32(d + 20);
+	if(!b || b & (b - 1) || b <= n
+		|| (catalog.size - CATALOG_HEADER) / 4 < b
+		|| (catalog.size - CATALOG_HEADER - 4 * b) / CATALOG_ENTRY < n
+		|| catalog.size - CATALOG_HEADER - 4 * b - CATALOG_ENTRY * n != s
+		|| !s || d[catalog.size - 1] != '\0') return 0;
+	catalog.entries_no = n, catalog.buckets_no = b, catalog.strings_size = s;
+	catalog.buckets = d + CATALOG_HEADER;
+	catalog.entries = catalog.buckets + 4 * b;
+	catalog.strings = (const char *)(catalog.entries + CATALOG_ENTRY * n);
+	/* So that lookups don't have to check. */
+	for(i = 0; i < b; i++) if(get32(catalog.buckets + 4 * i) > n) return 0;
+	for(i = 0; i < n; i++) {
+		const unsigned char *const e = catalog.entries + CATALOG_ENTRY * i;
+		if(get32(e + 8) >= s || get32(e + 12) >= s || get32(e + 16) >= s)
+			return 0;
+	}
+	return 1;
+}
+
+/** Loads the catalog of the last run; if there isn't one, or it's not one
+ that can be read, it's empty. @return Success. @throws[fopen, fread] */
+static int load(void) {
+	unload();
+	if(!map_catalog(CharArrayGet(&catalog.fn))) {
+		if(errno == ENOENT) errno = 0;
+		return !errno;
+	}
+	if(!check()) unload();
+	return 1;
+}
+
+/** Opens the catalog `fn` from the last run and starts a new one. Call before
+ any threads use it.
+ @return Success. @throws[malloc, fopen, fread] */
+int Catalog(const char *const fn) {
+	const size_t fn_size = strlen(fn) + 1;
+	char *copy;
+	assert(fn);
+	Catalog_();
+	if(!(copy = CharArrayBuffer(&catalog.fn, fn_size))) return 0;
+	memcpy(copy, fn, fn_size);
+	catalog.is_open = 1;
+	return load();
+}
+
+/** @return The file of the catalog, or null if there's none open. */
+const char *CatalogName(void) {
+	return catalog.is_open ? CharArrayGet(&catalog.fn) : 0;
+}
+
+/** Looks for `label` in `division`, that has `hash`, in the catalog from the
+ last run. Any thread can call this.
+ @param[found] If it returns true, this is filled; the strings are in the
+ catalog that was loaded, and are valid until <fn:CatalogWrite>, which loads
+ it again, or <fn:Catalog_>.
+ @return Whether it was found. */
+int CatalogFind(const unsigned division, const char *const label,
+	const unsigned long hash, struct CatalogSymbol *const found) {
+	unsigned long mask, b, i;
+	assert(label && found);
+	if(!catalog.entries_no) return 0;
+	mask = catalog.buckets_no - 1;
+	for(b = bucket(division, hash, mask);
+		(i = get32(catalog.buckets + 4 * b)); b = (b + 1) & mask) {
+		const unsigned char *const e
+			= catalog.entries + CATALOG_ENTRY * (i - 1);
+		const unsigned long info = get32(e + 4);
+		if(get32(e) != hash || (info & 0xff) != division
+			|| strcmp(catalog.strings + get32(e + 8), label)) continue;
+		found->hash = hash, found->division = division;
+		found->is_html = !!(info >> 8 & 1);
+		found->label = catalog.strings + get32(e + 8);
+		found->output = catalog.strings + get32(e + 12);
+		found->source = catalog.strings + get32(e + 16);
+		found->line = get32(e + 20);
+		return 1;
+	}
+	return 0;
+}
+
+/** Appends the string `s` to `strings`. @return The offset, or `(size_t)-1`.
+ @throws[realloc] */
+static size_t pool(struct CharArray *const strings, const char *const s) {
+	const size_t offset = CharArraySize(strings), size = strlen(s) + 1;
+	char *c;
+	if(!(c = CharArrayBuffer(strings, size))) return (size_t)-1;
+	memcpy(c, s, size);
+	return offset;
+}
+
+/** @return The 32-bit FNV-1a hash of `s`. */
+static unsigned long string_hash(const char *s) {
+	unsigned long h = 0x811c9dc5UL;
+	while(*s) h = ((h ^ (unsigned char)*s++) * 0x01000193UL) & 0xffffffffUL;
+	return h;
+}
+
+/** @return The bucket in `interned` of `s`, which is empty if it's not there.
+ There must be an empty one. */
+static size_t intern_bucket(const char *const s) {
+	const size_t *const t = SizeArrayGet(&catalog.interned),
+		mask = SizeArraySize(&catalog.interned) - 1;
+	const char *const strings = CharArrayGet(&catalog.next_strings);
+	size_t b;
+	for(b = (size_t)string_hash(s) & mask;
+		t[b] && strcmp(strings + t[b] - 1, s); b = (b + 1) & mask);
+	return b;
+}
+
+/** Appends `s` to the strings of the new catalog, unless it was interned
+ already; outputs and sources are the same in many entries.
+ @return The offset, or `(size_t)-1`. @throws[realloc] */
+static size_t intern(const char *const s) {
+	const size_t size = SizeArraySize(&catalog.interned);
+	size_t *t, *o, b, i;
+	/* Double it when it's half full; all are put in again. */
+	if(SizeArraySize(&catalog.interned_offsets) >= size >> 1) {
+		const size_t *const offsets = SizeArrayGet(&catalog.interned_offsets);
+		const char *const strings = CharArrayGet(&catalog.next_strings);
+		SizeArrayClear(&catalog.interned);
+		if(!(t = SizeArrayBuffer(&catalog.interned, size ? size << 1 : 64)))
+			return (size_t)-1;
+		memset(t, 0, sizeof *t * SizeArraySize(&catalog.interned));
+		for(i = 0; i < SizeArraySize(&catalog.interned_offsets); i++)
+			t[intern_bucket(strings + offsets[i])] = offsets[i] + 1;
+	}
+	t = SizeArrayGet(&catalog.interned);
+	if(t[b = intern_bucket(s)]) return t[b] - 1;
+	if(!(o = SizeArrayNew(&catalog.interned_offsets))) return (size_t)-1;
+	if((*o = pool(&catalog.next_strings, s)) == (size_t)-1)
+		{ SizeArrayPop(&catalog.interned_offsets); return (size_t)-1; }
+	t[b] = *o + 1;
+	return *o;
+}
+
+/** The symbols of `out_fn` from the last run are not kept; the ones that are
+ added now replace them. Any thread can call this.
+ @return Success. @throws[realloc] */
+int CatalogOutput(const char *const out_fn) {
+	int success;
+	assert(out_fn);
+	if(!catalog.is_open) return 1;
+#ifdef CATALOG_POSIX
+	pthread_mutex_lock(&catalog_lock);
+#endif
+	success = pool(&catalog.redone, out_fn) != (size_t)-1;
+#ifdef CATALOG_POSIX
+	pthread_mutex_unlock(&catalog_lock);
+#endif
+	return success;
+}
+
+/** Adds `symbol` to the new catalog. Any thread can call this.
+ @return Success. @throws[realloc] */
+int CatalogAdd(const struct CatalogSymbol *const symbol) {
+	struct Entry *e;
+	int success = 0;
+	assert(symbol && symbol->label && symbol->output && symbol->source);
+	if(!catalog.is_open) return 1;
+#ifdef CATALOG_POSIX
+	pthread_mutex_lock(&catalog_lock);
+#endif
+	if(!(e = EntryArrayNew(&catalog.next))) goto finally;
+	e->hash = symbol->hash & 0xffffffff, e->line = symbol->line & 0xffffffff;
+	e->division = symbol->division, e->is_html = symbol->is_html;
+	if((e->label = pool(&catalog.next_strings, symbol->label)) == (size_t)-1
+		|| (e->output = intern(symbol->output)) == (size_t)-1
+		|| (e->source = intern(symbol->source)) == (size_t)-1)
+		{ EntryArrayPop(&catalog.next); goto finally; }
+	success = 1;
+finally:
+#ifdef CATALOG_POSIX
+	pthread_mutex_unlock(&catalog_lock);
+#endif
+	return success;
+}
+
+/** Orders the names that `a` and `b` point to. Implements `qsort`,
+ `bsearch`. */
+static int name_compare(const void *const a, const void *const b) {
+	return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+/* Entries sort on these while writing. */
+static const char *sort_strings;
+
+/** Orders by division, label, and output, so that the first of the same
+ label is always the same. Implements `qsort`. */
+static int entry_compare(const void *const a, const void *const b) {
+	const struct Entry *const x = a, *const y = b;
+	int c;
+	if(x->division != y->division) return x->division < y->division ? -1 : 1;
+	if((c = strcmp(sort_strings + x->label, sort_strings + y->label))) return c;
+	return strcmp(sort_strings + x->output, sort_strings + y->output);
+}
+
+/** Moves the symbols of the last catalog that were not redone to the new one.
+ The redone outputs are sorted, so it's \O(`entries` \log `redone`).
+ @return Success. @throws[realloc] */
+static int keep_old(void) {
+	struct NameArray redone;
+	const char *r = CharArrayGet(&catalog.redone),
+		*const r_end = r + CharArraySize(&catalog.redone), **name,
+		*last_output = 0;
+	int is_last_redone = 0, success = 0;
+	unsigned long i;
+	NameArray(&redone);
+	for( ; r < r_end; r += strlen(r) + 1) {
+		if(!(name = NameArrayNew(&redone))) goto finally;
+		*name = r;
+	}
+	if(NameArraySize(&redone)) qsort(NameArrayGet(&redone),
+		NameArraySize(&redone), sizeof *name, &name_compare);
+	for(i = 0; i < catalog.entries_no; i++) {
+		const unsigned char *const e = catalog.entries + CATALOG_ENTRY * i;
+		const char *const output = catalog.strings + get32(e + 12);
+		struct CatalogSymbol s;
+		/* The outputs were interned, so the same one is the same string. */
+		if(output != last_output) last_output = output, is_last_redone
+			= NameArraySize(&redone) && bsearch(&output, NameArrayGet(&redone),
+			NameArraySize(&redone), sizeof *name, &name_compare);
+		if(is_last_redone) continue;
+		s.hash = get32(e), s.division = get32(e + 4) & 0xff;
+		s.is_html = !!(get32(e + 4) >> 8 & 1);
+		s.label = catalog.strings + get32(e + 8), s.output = output;
+		s.source = catalog.strings + get32(e + 16), s.line = get32(e + 20);
+		if(!CatalogAdd(&s)) goto finally;
+	}
+	success = 1;
+finally:
+	NameArray_(&redone);
+	return success;
+}
+
+/** Writes the new catalog where the last one was, with the symbols of
+ outputs that were not redone. The file is written next to it and renamed
+ over it, so it's never half-written.
+ @return Success. @throws[realloc, fopen, fwrite, rename]
+ @throws[ERANGE] It would be bigger than 32 bits can say. */
+int CatalogWrite(void) {
+	struct ByteArray out;
+	struct CharArray temp;
+	struct Entry *e, *entries;
+	unsigned char *b, *buckets;
+	unsigned long n, capacity = 8, mask, i;
+	size_t strings_size, fn_len = CharArraySize(&catalog.fn) - 1;
+	FILE *fp = 0;
+	char *t;
+	int success = 0;
+	assert(catalog.is_open);
+	ByteArray(&out), CharArray(&temp);
+	if(!keep_old()) goto finally;
+	n = (unsigned long)EntryArraySize(&catalog.next);
+	strings_size = CharArraySize(&catalog.next_strings);
+	if(n > 0x3fffffffUL || strings_size > 0x7fffffffUL)
+		{ errno = ERANGE; goto finally; }
+	while(capacity <= n << 1) capacity <<= 1;
+	mask = capacity - 1;
+	entries = EntryArrayGet(&catalog.next);
+	sort_strings = CharArrayGet(&catalog.next_strings);
+	if(n) qsort(entries, (size_t)n, sizeof *entries, &entry_compare);
+	if(!(b = ByteArrayBuffer(&out, CATALOG_HEADER + 4 * capacity
+		+ CATALOG_ENTRY * n + (strings_size ? strings_size : 1)))) goto finally;
+	memset(b, 0, ByteArraySize(&out));
+	memcpy(b, catalog_magic, sizeof catalog_magic);
+	put32(b + 8, catalog_version), put32(b + 12, n), put32(b + 16, capacity);
+	put32(b + 20, strings_size ? strings_size : 1);
+	buckets = b + CATALOG_HEADER;
+	for(i = 0, e = entries; i < n; i++, e++) {
+		unsigned char *const en = buckets + 4 * capacity + CATALOG_ENTRY * i;
+		unsigned long k;
+		for(k = bucket(e->division, e->hash, mask); get32(buckets + 4 * k);
+			k = (k + 1) & mask);
+		put32(buckets + 4 * k, i + 1);
+		put32(en, e->hash);
+		put32(en + 4, (unsigned long)e->division | (e->is_html ? 0x100ul : 0));
+		put32(en + 8, e->label), put32(en + 12, e->output);
+		put32(en + 16, e->source), put32(en + 20, e->line);
+	}
+	if(strings_size) memcpy(buckets + 4 * capacity + CATALOG_ENTRY * n,
+		CharArrayGet(&catalog.next_strings), strings_size);
+	if(!(t = CharArrayBuffer(&temp, fn_len + sizeof ".4294967295.tmp")))
+		goto finally;
+	memcpy(t, CharArrayGet(&catalog.fn), fn_len);
+	/* Another process writing the same catalog doesn't share the file. */
+#ifdef CATALOG_POSIX
+	sprintf(t + fn_len, ".%lu.tmp", (unsigned long)getpid() & 0xffffffffUL);
+#else
+	memcpy(t + fn_len, ".tmp", sizeof ".tmp");
+#endif
+	if(!(fp = fopen(t, "wb"))) goto finally;
+	if(fwrite(ByteArrayGet(&out), 1, ByteArraySize(&out), fp)
+		!= ByteArraySize(&out)) goto finally;
+	if(fclose(fp) == EOF) { fp = 0; goto finally; }
+	fp = 0;
+#ifndef CATALOG_POSIX
+	remove(CharArrayGet(&catalog.fn)); /* `rename` may not replace. */
+#endif
+	if(rename(t, CharArrayGet(&catalog.fn))) goto finally;
+	/* Another run, (with `--watch`,) starts from what's there now. */
+	success = load();
+finally:
+	if(fp) fclose(fp);
+	EntryArrayClear(&catalog.next);
+	CharArrayClear(&catalog.next_strings);
+	CharArrayClear(&catalog.redone);
+	SizeArrayClear(&catalog.interned);
+	SizeArrayClear(&catalog.interned_offsets);
+	ByteArray_(&out), CharArray_(&temp);
+	return success;
+}
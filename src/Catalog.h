@@ -0,0 +1,18 @@
+/** A documented symbol in `output`: `label` in `division`, with it's `hash`,
+ from `source` on `line`. The anchor is either HTML, or Markdown, which uses
+ the hash. */
+struct CatalogSymbol {
+	const char *label, *output, *source;
+	unsigned division;
+	int is_html;
+	unsigned long hash, line;
+};
+
+void Catalog_(void);
+int Catalog(const char *const fn);
+const char *CatalogName(void);
+int CatalogFind(const unsigned division, const char *const label,
+	const unsigned long hash, struct CatalogSymbol *const found);
+int CatalogOutput(const char *const out_fn);
+int CatalogAdd(const struct CatalogSymbol *const symbol);
+int CatalogWrite(void);
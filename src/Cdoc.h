@@ -1,7 +1,8 @@
+#include <stdio.h> /* FILE */
 #include "Debug.h"
 #include "Format.h"
 
 enum Debug CdocGetDebug(void);
-enum Format CdocGetFormat(void);
-const char *CdocGetInput(void);
-const char *CdocGetOutput(void);
+int CdocGetDocOnly(void);
+FILE *CdocGetErr(void);
+void CdocPerror(const char *const s);
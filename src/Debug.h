@@ -19,7 +19,8 @@
 	X(DBG_44), X(DBG_45), X(DBG_46), X(DBG_47), X(DBG_48), X(DBG_49), \
 	X(DBG_50), X(DBG_51), X(DBG_52), X(DBG_53), X(DBG_54), X(DBG_55), \
 	X(DBG_56), X(DBG_57), X(DBG_58), X(DBG_59), X(DBG_60), X(DBG_61), \
-	X(DBG_62), X(DBG_63)
+	X(DBG_62), X(DBG_63), \
+	X(DBG_MEMORY)
 
 enum Debug { DEBUG(PARAM) };
 static const char *const debugs[] = { DEBUG(STRINGISE) };
@@ -0,0 +1,119 @@
+/** @license 2019 Neil Edelman, distributed under the terms of the
+ [MIT License](https://opensource.org/licenses/MIT).
+
+ The files that the document on this thread depends on, in the order that
+ they were first read: the input, it's local includes, and the local images
+ and links that were checked. <fn:DependClear> starts the next document.
+ <fn:DependMake> says it to make, so the documents can be rebuilt when any of
+ them change.
+
+ @std C89 */
+
+#include <stddef.h> /* size_t */
+#include <string.h> /* strlen strcmp memcpy */
+#include <assert.h> /* assert */
+#include "ThreadLocal.h"
+#include "Depend.h" /** \include */
+
+#define ARRAY_NAME Char
+#define ARRAY_TYPE char
+#include "Array.h"
+
+#define ARRAY_NAME Size
+#define ARRAY_TYPE size_t
+#include "Array.h"
+
+/* The `names` are null-terminated, starting at `offsets`; `rule` is the
+ storage of <fn:DependMake>. */
+static THREAD_LOCAL struct {
+	struct CharArray names, rule;
+	struct SizeArray offsets;
+} depend;
+
+/** Destructor for the files of this thread. */
+void Depend_(void) {
+	CharArray_(&depend.names);
+	CharArray_(&depend.rule);
+	SizeArray_(&depend.offsets);
+}
+
+/** Forgets the files, for the next document. */
+void DependClear(void) {
+	CharArrayClear(&depend.names);
+	SizeArrayClear(&depend.offsets);
+}
+
+/** @return The number of files. */
+size_t DependSize(void) {
+	return SizeArraySize(&depend.offsets);
+}
+
+/** @return The name of file `i`, which is less then <fn:DependSize>. */
+const char *DependGet(const size_t i) {
+	assert(i < DependSize());
+	return CharArrayGet(&depend.names) + SizeArrayGet(&depend.offsets)[i];
+}
+
+/** Adds the file `fn`, if it's not there already, whether or not it could be
+ read; it could be there later.
+ @return Success. @throws[realloc] */
+int DependAdd(const char *const fn) {
+	size_t i, size;
+	size_t *offset;
+	char *copy;
+	assert(fn);
+	for(i = 0; i < DependSize(); i++) if(!strcmp(DependGet(i), fn)) return 1;
+	size = strlen(fn) + 1;
+	if(!(offset = SizeArrayNew(&depend.offsets))) return 0;
+	*offset = CharArraySize(&depend.names);
+	if(!(copy = CharArrayBuffer(&depend.names, size)))
+		{ SizeArrayPop(&depend.offsets); return 0; }
+	memcpy(copy, fn, size);
+	return 1;
+}
+
+/** Appends `fn` to the rule, escaped for make. @return Success.
+ @throws[realloc] */
+static int make_name(const char *fn) {
+	char *c;
+	for( ; *fn; fn++) {
+		const int is_escape = *fn == ' ' || *fn == '#' || *fn == '$';
+		if(!(c = CharArrayBuffer(&depend.rule, 1 + !!is_escape))) return 0;
+		if(is_escape) *c++ = *fn == '$' ? '$' : '\\';
+		*c = *fn;
+	}
+	return 1;
+}
+
+/** Appends the string `str` to the rule. @return Success. @throws[realloc] */
+static int make_str(const char *const str) {
+	const size_t len = strlen(str);
+	char *c;
+	if(!(c = CharArrayBuffer(&depend.rule, len))) return 0;
+	memcpy(c, str, len);
+	return 1;
+}
+
+/** @param[is_phony] Every file but the first also gets an empty rule, so that
+ make doesn't stop when one is deleted, like `-MP`.
+ @return A make rule that `target` depends on the files, valid until the next
+ call, or null. @throws[realloc] */
+const char *DependMake(const char *const target, const int is_phony) {
+	size_t i;
+	char *end;
+	assert(target);
+	CharArrayClear(&depend.rule);
+	if(!make_name(target) || !make_str(":")) return 0;
+	for(i = 0; i < DependSize(); i++) {
+		if(!make_str(i ? " \\\n " : " ")
+			|| !make_name(DependGet(i))) return 0;
+	}
+	if(!make_str("\n")) return 0;
+	if(is_phony) for(i = 1; i < DependSize(); i++) {
+		if(!make_str("\n") || !make_name(DependGet(i))
+			|| !make_str(":\n")) return 0;
+	}
+	if(!(end = CharArrayNew(&depend.rule))) return 0;
+	*end = '\0';
+	return CharArrayGet(&depend.rule);
+}
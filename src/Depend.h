@@ -0,0 +1,6 @@
+void Depend_(void);
+void DependClear(void);
+size_t DependSize(void);
+const char *DependGet(const size_t i);
+int DependAdd(const char *const fn);
+const char *DependMake(const char *const target, const int is_phony);
@@ -0,0 +1,197 @@
+/** @license 2019 Neil Edelman, distributed under the terms of the
+ [MIT License](https://opensource.org/licenses/MIT).
+
+ Finds the span of text that can be output without escaping, so that it can
+ be copied all at once. Membership is a pair of nibble tables: a byte is in
+ the set if the entry of its low nibble and the entry of its high nibble share
+ a bit. The scalar kernel looks them up directly; the AVX2 kernel does 32 at a
+ time with `vpshufb`. SSE2 has no byte shuffle, so it compares 16 bytes with
+ the members, or ranges of them. On x86-64 Linux with GCC or Clang, AVX2 is
+ chosen at run-time.
+
+ @std C89, SSE2, AVX2 */
+
+#include <stddef.h> /* size_t */
+#include <assert.h> /* assert */
+#ifdef __SSE2__ /* <-- sse2 */
+#define ESCAPE_USE_SSE2
+#include <emmintrin.h> /* _mm_* */
+#endif /* sse2 --> */
+#if defined(ESCAPE_USE_SSE2) && defined(__GNUC__) && defined(__x86_64__) \
+	&& defined(__linux__) /* <-- x */
+#define ESCAPE_USE_AVX2
+#include <immintrin.h> /* _mm256_* */
+#endif /* x --> */
+#include "Escape.h" /** \include */
+
+struct Set { unsigned char lo[16], hi[16]; };
+
+/* "\0<>&": high nibbles 0, 3, and 2 are bits 1, 2, and 4. */
+static const struct Set html_set = {
+	{ 0x01, 0, 0, 0, 0, 0, 0x04, 0, 0, 0, 0, 0, 0x02, 0, 0x02, 0 },
+	{ 0x01, 0, 0x04, 0x02, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 } };
+
+/* "\0!#()*+-.[\\]_`{}": high nibbles 0, 2, 5, 6, and 7 are bits 1, 2, 4, 8,
+ and 16. */
+static const struct Set md_set = {
+	{ 0x09, 0x02, 0, 0x02, 0, 0, 0, 0,
+	0x02, 0x02, 0x02, 0x16, 0x04, 0x16, 0x02, 0x04 },
+	{ 0x01, 0, 0x02, 0, 0, 0x04, 0x08, 0x10, 0, 0, 0, 0, 0, 0, 0, 0 } };
+
+static const struct Set *const sets[] = { &html_set, &md_set };
+
+/** @return The length of the prefix of `from` up to `length` that has no
+ members of `set`. */
+static size_t span_scalar(const struct Set *const set,
+	const char *const from, const size_t length) {
+	size_t i;
+	for(i = 0; i < length; i++) {
+		const unsigned char c = (unsigned char)from[i];
+		if(set->lo[c & 15] & set->hi[c >> 4]) break;
+	}
+	return i;
+}
+
+#ifdef ESCAPE_USE_SSE2 /* <-- sse2 */
+/** @return The position of the lowest bit of non-zero `hit`. */
+static size_t first_bit(unsigned hit) {
+#ifdef __GNUC__
+	return (size_t)__builtin_ctz(hit);
+#else
+	size_t i = 0;
+	assert(hit);
+	while(!(hit & 1)) hit >>= 1, i++;
+	return i;
+#endif
+}
+
+/** @return The bits of the bytes of `x` that are in `html_set`. */
+static unsigned sse2_html(const __m128i x) {
+	return (unsigned)_mm_movemask_epi8(_mm_or_si128(
+		_mm_or_si128(_mm_cmpeq_epi8(x, _mm_setzero_si128()),
+		_mm_cmpeq_epi8(x, _mm_set1_epi8('<'))),
+		_mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('>')),
+		_mm_cmpeq_epi8(x, _mm_set1_epi8('&')))));
+}
+
+/** @return The bits of the bytes of `x` that are in `md_set`. Bytes past
+ ASCII are negative, so they are never in a range. */
+static unsigned sse2_md(const __m128i x) {
+	/* "()*+,-." without ','. */
+	const __m128i paren = _mm_andnot_si128(_mm_cmpeq_epi8(x,
+		_mm_set1_epi8(',')), _mm_and_si128(_mm_cmpgt_epi8(x,
+		_mm_set1_epi8('(' - 1)), _mm_cmplt_epi8(x, _mm_set1_epi8('.' + 1)))),
+	/* "[\\]^_`" without '^'. */
+		bracket = _mm_andnot_si128(_mm_cmpeq_epi8(x,
+		_mm_set1_epi8('^')), _mm_and_si128(_mm_cmpgt_epi8(x,
+		_mm_set1_epi8('[' - 1)), _mm_cmplt_epi8(x, _mm_set1_epi8('`' + 1)))),
+		single = _mm_or_si128(_mm_or_si128(
+		_mm_cmpeq_epi8(x, _mm_setzero_si128()),
+		_mm_cmpeq_epi8(x, _mm_set1_epi8('!'))),
+		_mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('#')),
+		_mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8('{')),
+		_mm_cmpeq_epi8(x, _mm_set1_epi8('}')))));
+	return (unsigned)_mm_movemask_epi8(_mm_or_si128(single,
+		_mm_or_si128(paren, bracket)));
+}
+
+/** <fn:span_scalar> 16 bytes at a time. */
+static size_t span_sse2(const struct Set *const set,
+	const char *const from, const size_t length) {
+	const int is_md = set == &md_set;
+	size_t i;
+	assert(is_md || set == &html_set);
+	for(i = 0; i + 16 <= length; i += 16) {
+		const __m128i x = _mm_loadu_si128((const __m128i *)(from + i));
+		const unsigned hit = is_md ? sse2_md(x) : sse2_html(x);
+		if(hit) return i + first_bit(hit);
+	}
+	return i + span_scalar(set, from + i, length - i);
+}
+#endif /* sse2 --> */
+
+#ifdef ESCAPE_USE_AVX2 /* <-- avx2 */
+/** <fn:span_scalar> 32 bytes at a time. */
+__attribute__((target("avx2")))
+static size_t span_avx2(const struct Set *const set,
+	const char *const from, const size_t length) {
+	const __m256i lo = _mm256_broadcastsi128_si256(
+		_mm_loadu_si128((const __m128i *)set->lo)),
+		hi = _mm256_broadcastsi128_si256(
+		_mm_loadu_si128((const __m128i *)set->hi)),
+		nibble = _mm256_set1_epi8(0x0f), zero = _mm256_setzero_si256();
+	size_t i;
+	for(i = 0; i + 32 <= length; i += 32) {
+		const __m256i x = _mm256_loadu_si256((const __m256i *)(from + i)),
+			l = _mm256_shuffle_epi8(lo, _mm256_and_si256(x, nibble)),
+			h = _mm256_shuffle_epi8(hi,
+			_mm256_and_si256(_mm256_srli_epi16(x, 4), nibble));
+		/* Bits that are set are not members. */
+		const unsigned miss = (unsigned)_mm256_movemask_epi8(
+			_mm256_cmpeq_epi8(_mm256_and_si256(l, h), zero));
+		if(miss != 0xffffffffu) return i + (size_t)__builtin_ctz(~miss);
+	}
+	return i + span_sse2(set, from + i, length - i);
+}
+#endif /* avx2 --> */
+
+/** @return Whether `kernel` can run on this machine. */
+int EscapeHasKernel(const enum EscapeKernel kernel) {
+	switch(kernel) {
+	case ESCAPE_SCALAR: return 1;
+	case ESCAPE_SSE2:
+#ifdef ESCAPE_USE_SSE2
+		return 1;
+#else
+		return 0;
+#endif
+	case ESCAPE_AVX2:
+#ifdef ESCAPE_USE_AVX2
+		return __builtin_cpu_supports("avx2");
+#else
+		return 0;
+#endif
+	}
+	return 0;
+}
+
+/** Testing and benchmarking; <fn:EscapeSpan> is what one wants.
+ @param[kernel] If it's not available, falls back to scalar.
+ @return The length of the prefix of `from` up to `length` that doesn't have
+ to be escaped in `set`. */
+size_t EscapeSpanKernel(const enum EscapeKernel kernel,
+	const enum EscapeSet set, const char *const from, const size_t length) {
+	const struct Set *const s = sets[set];
+	assert(from || !length);
+	switch(kernel) {
+	case ESCAPE_SCALAR: break;
+	case ESCAPE_SSE2:
+#ifdef ESCAPE_USE_SSE2
+		return span_sse2(s, from, length);
+#else
+		break;
+#endif
+	case ESCAPE_AVX2:
+#ifdef ESCAPE_USE_AVX2
+		if(__builtin_cpu_supports("avx2")) return span_avx2(s, from, length);
+#endif
+		break;
+	}
+	return span_scalar(s, from, length);
+}
+
+/** @return The length of the prefix of `from` up to `length` that doesn't have
+ to be escaped in `set`, using the best kernel. */
+size_t EscapeSpan(const enum EscapeSet set, const char *const from,
+	const size_t length) {
+	assert(from || !length);
+#ifdef ESCAPE_USE_AVX2
+	if(__builtin_cpu_supports("avx2"))
+		return span_avx2(sets[set], from, length);
+#endif
+#ifdef ESCAPE_USE_SSE2
+	return span_sse2(sets[set], from, length);
+#else
+	return span_scalar(sets[set], from, length);
+#endif
+}
@@ -0,0 +1,11 @@
+/** Characters that have to be escaped; `'\0'` is always included. */
+enum EscapeSet { ESCAPE_HTML, ESCAPE_MD };
+
+/** Implementations of <fn:EscapeSpan>. */
+enum EscapeKernel { ESCAPE_SCALAR, ESCAPE_SSE2, ESCAPE_AVX2 };
+
+int EscapeHasKernel(const enum EscapeKernel kernel);
+size_t EscapeSpanKernel(const enum EscapeKernel kernel,
+	const enum EscapeSet set, const char *const from, const size_t length);
+size_t EscapeSpan(const enum EscapeSet set, const char *const from,
+	const size_t length);
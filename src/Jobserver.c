@@ -0,0 +1,146 @@
+/** @license 2019 Neil Edelman, distributed under the terms of the
+ [MIT License](https://opensource.org/licenses/MIT).
+
+ Works with the jobserver of GNU make, so that `--jobs` under `make -j` does
+ not run more threads than make allows. Every process that make starts has
+ one job implicitly; every other thread needs a token, a byte that is read
+ from the jobserver, and is written back when it's done. make says where the
+ jobserver is in `MAKEFLAGS`: `--jobserver-auth=R,W` are the file descriptors
+ of a pipe, (`--jobserver-fds` before make 4.2,) and
+ `--jobserver-auth=fifo:PATH` is a named pipe, (make 4.4.) Only tokens that
+ are there already are taken. On a pipe, another process could take one
+ between `poll` and `read`; then this waits for the next. If make says there
+ is a jobserver, but it can't be used, (it doesn't pass the descriptors to
+ recipes that aren't marked `+`,) there is only the one job.
+
+ @std C89, POSIX.1-2001 `poll` `open` `read` `write` `fcntl` */
+
+#if defined(__unix__) || defined(__APPLE__)
+#define JOBSERVER_POSIX
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L /* poll open read write fcntl close */
+#endif
+#endif
+
+#include <stddef.h> /* size_t */
+#include <stdlib.h> /* getenv strtol */
+#include <string.h> /* strstr strlen strncmp strcspn memcpy */
+#include <limits.h> /* INT_MAX */
+#include <errno.h>  /* errno EINTR */
+#ifdef JOBSERVER_POSIX /* <-- posix */
+#include <sys/types.h> /* ssize_t */
+#include <fcntl.h>     /* open fcntl */
+#include <unistd.h>    /* read write close */
+#include <poll.h>      /* poll */
+#endif /* posix --> */
+#include "Jobserver.h" /** \include */
+
+#ifdef JOBSERVER_POSIX /* <-- posix */
+
+/* `in` and `out` are the jobserver; if `is_fifo`, it was opened here, and
+ `in` is `out`. `tokens` are held. */
+static struct {
+	int in, out, is_fifo;
+	size_t tokens_no;
+	char tokens[256];
+} jobserver = { -1, -1, 0, 0, "" };
+
+/** @return Whether `fd` is open in this process. */
+static int is_open(const long fd) {
+	return fd >= 0 && fd <= INT_MAX && fcntl((int)fd, F_GETFD) != -1;
+}
+
+/** Whether `MAKEFLAGS` has a jobserver, and whether it can be used. */
+enum JobserverFind { JOBSERVER_NONE, JOBSERVER_UNUSABLE, JOBSERVER_USABLE };
+
+/** Finds the jobserver in `MAKEFLAGS` and opens it if it's named.
+ @return Whether there is one, and whether it can be used. */
+static enum JobserverFind jobserver_find(void) {
+	const char *const options[] = { "--jobserver-auth=", "--jobserver-fds=" },
+		*const flags = getenv("MAKEFLAGS"), *auth = 0, *a;
+	char path[1024], *end;
+	long in, out;
+	size_t o, len;
+	if(!flags) return JOBSERVER_NONE;
+	/* If there are many, the last one counts. */
+	for(o = 0; o < sizeof options / sizeof *options; o++) {
+		len = strlen(options[o]);
+		for(a = flags; (a = strstr(a, options[o])); a += len)
+			if(!auth || a + len > auth) auth = a + len;
+	}
+	if(!auth) return JOBSERVER_NONE;
+	if(!strncmp(auth, "fifo:", 5)) {
+		auth += 5;
+		if((len = strcspn(auth, " \t")) >= sizeof path)
+			return JOBSERVER_UNUSABLE;
+		memcpy(path, auth, len), path[len] = '\0';
+		/* A descriptor of our own, so it can be non-blocking. */
+		if((jobserver.in = open(path, O_RDWR | O_NONBLOCK)) == -1)
+			return JOBSERVER_UNUSABLE;
+		jobserver.out = jobserver.in, jobserver.is_fifo = 1;
+		return JOBSERVER_USABLE;
+	}
+	in = strtol(auth, &end, 10);
+	if(end == auth || *end != ',') return JOBSERVER_UNUSABLE;
+	out = strtol(a = end + 1, &end, 10);
+	/* make doesn't always give them to us. */
+	if(end == a || !is_open(in) || !is_open(out)) return JOBSERVER_UNUSABLE;
+	jobserver.in = (int)in, jobserver.out = (int)out;
+	return JOBSERVER_USABLE;
+}
+
+/** Takes the tokens that are there now from make for up to `jobs - 1` more
+ threads; they must be given back with <fn:Jobserver_>. `errno` is not
+ changed.
+ @return The number of threads that can run, at least one. If there's no
+ jobserver, that's `jobs`; if there is, but it can't be used, it's one. */
+unsigned Jobserver(const unsigned jobs) {
+	const int e = errno;
+	unsigned threads = 1;
+	if(jobs <= 1) return 1;
+	switch(jobserver_find()) {
+	case JOBSERVER_NONE: errno = e; return jobs;
+	case JOBSERVER_UNUSABLE: errno = e; return 1;
+	case JOBSERVER_USABLE: break;
+	}
+	while(threads < jobs && jobserver.tokens_no < sizeof jobserver.tokens) {
+		ssize_t r;
+		if(!jobserver.is_fifo) {
+			struct pollfd p;
+			p.fd = jobserver.in, p.events = POLLIN, p.revents = 0;
+			if(poll(&p, 1, 0) != 1 || !(p.revents & POLLIN)) break;
+		}
+		r = read(jobserver.in, jobserver.tokens + jobserver.tokens_no, 1);
+		if(r == -1 && errno == EINTR) continue;
+		if(r != 1) break;
+		jobserver.tokens_no++, threads++;
+	}
+	errno = e;
+	return threads;
+}
+
+/** Gives back the tokens and closes the jobserver if it was opened. */
+void Jobserver_(void) {
+	size_t i = 0;
+	const int e = errno;
+	while(i < jobserver.tokens_no) {
+		const ssize_t w = write(jobserver.out, jobserver.tokens + i,
+			jobserver.tokens_no - i);
+		if(w < 0) { if(errno == EINTR) continue; break; }
+		i += (size_t)w;
+	}
+	jobserver.tokens_no = 0;
+	if(jobserver.is_fifo) close(jobserver.in);
+	jobserver.in = jobserver.out = -1, jobserver.is_fifo = 0;
+	errno = e;
+}
+
+#else /* posix --><-- !posix */
+
+/** Without a jobserver. @return `jobs`, at least one. */
+unsigned Jobserver(const unsigned jobs) { return jobs ? jobs : 1; }
+
+/** Without a jobserver, does nothing. */
+void Jobserver_(void) {}
+
+#endif /* !posix --> */
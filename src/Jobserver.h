@@ -0,0 +1,2 @@
+unsigned Jobserver(const unsigned jobs);
+void Jobserver_(void);
@@ -0,0 +1,432 @@
+/** @license 2019 Neil Edelman, distributed under the terms of the
+ [MIT License](https://opensource.org/licenses/MIT).
+
+ An incremental build. The manifest remembers, for every output, a hash of
+ the input name and the options, and every file that was read to make it,
+ (see `Depend.h`,) with the size, the modification time, and a hash of the
+ contents. If none of them changed, and the output is still there, then the
+ output is current, and the input doesn't have to be scanned. The size and
+ the time are checked first; only if the time differs are the contents hashed,
+ mapped with `mmap` where it's available. Files that were read as text are
+ recorded as they were when they were read, (see `Text.h`,) so a file that
+ changes while it's being documented is not current the next time. A file
+ that was changed in the same second that it was read could change again
+ unseen, so it's time is not kept. Outputs can be recorded from any thread.
+ The hash is FNV-1a of `unsigned long`, which is 64 bits on most systems.
+
+ The file is text: a version line, then `output <options> <size> <file>`
+ followed by a `read <size> <time> <hash> <file>` for every file that was
+ read, with a size of -1 if it was not there. Anything that doesn't parse
+ starts over.
+
+ @std C89, POSIX.1-2001 `stat` `mmap` `pthread` */
+
+#if defined(__unix__) || defined(__APPLE__)
+#define MANIFEST_POSIX
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L /* stat open mmap pthread */
+#endif
+#endif
+
+#include <stddef.h> /* size_t */
+#include <stdlib.h> /* strtol strtoul qsort bsearch */
+#include <stdio.h>  /* FILE fopen fread fwrite fprintf sprintf rename */
+#include <string.h> /* strlen strcmp strncmp strchr memcpy */
+#include <limits.h> /* ULONG_MAX */
+#include <time.h>   /* time */
+#include <errno.h>  /* errno */
+#include <assert.h> /* assert */
+#ifdef MANIFEST_POSIX /* <-- posix */
+#include <sys/types.h> /* off_t */
+#include <sys/stat.h>  /* stat */
+#include <sys/mman.h>  /* mmap munmap */
+#include <fcntl.h>     /* open */
+#include <unistd.h>    /* read close getpid */
+#include <pthread.h>   /* pthread_mutex */
+#endif /* posix --> */
+#include "Depend.h"
+#include "Text.h"
+#include "Manifest.h" /** \include */
+
+#if ULONG_MAX > 0xffffffffUL
+#define MANIFEST_FNV_BASIS 0xcbf29ce484222325UL
+#define MANIFEST_FNV_PRIME 0x100000001b3UL
+#else
+#define MANIFEST_FNV_BASIS 0x811c9dc5UL
+#define MANIFEST_FNV_PRIME 0x01000193UL
+#endif
+
+/* Change this when the output of the same options could be different. */
+static const char *const manifest_version = "cdoc manifest 1";
+
+#define ARRAY_NAME Char
+#define ARRAY_TYPE char
+#include "Array.h"
+
+/** A file that was read; if it wasn't there, `size` is -1. If `mtime` is -1,
+ the contents have to be hashed. */
+struct Read { long size, mtime; unsigned long hash; const char *fn; };
+
+#define ARRAY_NAME Read
+#define ARRAY_TYPE struct Read
+#include "Array.h"
+
+/** An output, and `reads_no` reads from `read`. If `is_replaced`, there's a
+ new record of it. */
+struct Output {
+	const char *fn;
+	unsigned long options;
+	long size;
+	size_t read, reads_no;
+	int is_replaced;
+};
+
+#define ARRAY_NAME Output
+#define ARRAY_TYPE struct Output
+#include "Array.h"
+
+/* The `outputs` and `reads` are from `file`, which was loaded from `fn` and
+ broken into strings; the `outputs` are sorted. New records go in `next`,
+ under `lock`. */
+static struct {
+	struct CharArray fn, file, next;
+	struct OutputArray outputs;
+	struct ReadArray reads;
+	int is_loaded;
+} manifest;
+#ifdef MANIFEST_POSIX /* <-- posix */
+static pthread_mutex_t manifest_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif /* posix --> */
+
+/** @return Continues the hash `h` with `size` bytes of `data`. */
+static unsigned long fnv(unsigned long h, const void *const data,
+	const size_t size) {
+	const unsigned char *d = data, *const end = d + size;
+	while(d < end) h = ((h ^ *d++) * MANIFEST_FNV_PRIME) & ULONG_MAX;
+	return h;
+}
+
+/** @return The hash of the name `in_fn` and the `flags`. */
+static unsigned long options_hash(const char *const in_fn,
+	const unsigned flags) {
+	char f[32];
+	sprintf(f, "\n%u", flags);
+	return fnv(fnv(MANIFEST_FNV_BASIS, in_fn, strlen(in_fn)), f, strlen(f));
+}
+
+/** Puts the size and time of `fn` in `r`; if it's not there, the size is -1.
+ Without `stat`, the time is always -1. */
+static void file_stat(const char *const fn, struct Read *const r) {
+#ifdef MANIFEST_POSIX /* <-- posix */
+	struct stat st;
+	if(stat(fn, &st) == -1) { r->size = -1, r->mtime = -1; return; }
+	r->size = (long)st.st_size, r->mtime = (long)st.st_mtime;
+#else /* posix --><-- !posix */
+	FILE *const fp = fopen(fn, "rb");
+	long size = -1;
+	if(fp) fseek(fp, 0l, SEEK_END), size = ftell(fp), fclose(fp);
+	r->size = size, r->mtime = -1;
+#endif /* !posix --> */
+}
+
+/** Puts the hash of the contents of `fn` in `hash`.
+ @return Success. @throws[open, mmap, fopen, fread] */
+static int file_hash(const char *const fn, unsigned long *const hash) {
+	unsigned long h = MANIFEST_FNV_BASIS;
+	char buffer[4096];
+	size_t nread;
+	FILE *fp;
+#ifdef MANIFEST_POSIX /* <-- posix */
+	struct stat st;
+	int fd;
+	void *map;
+	if((fd = open(fn, O_RDONLY)) == -1) return 0;
+	if(fstat(fd, &st) == -1) { close(fd); return 0; }
+	if(!S_ISREG(st.st_mode) || st.st_size <= 0
+		|| (off_t)(size_t)st.st_size != st.st_size || (map = mmap(0,
+		(size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED) {
+		close(fd);
+		goto read;
+	}
+	close(fd);
+	*hash = fnv(h, map, (size_t)st.st_size);
+	munmap(map, (size_t)st.st_size);
+	return 1;
+read:
+#endif /* posix --> */
+	if(!(fp = fopen(fn, "rb"))) return 0;
+	while((nread = fread(buffer, 1, sizeof buffer, fp)))
+		h = fnv(h, buffer, nread);
+	if(ferror(fp)) { fclose(fp); return 0; }
+	fclose(fp);
+	*hash = h;
+	return 1;
+}
+
+/** Orders outputs by name. Implements `qsort` and `bsearch`. */
+static int output_compare(const void *const a, const void *const b) {
+	return strcmp(((const struct Output *)a)->fn,
+		((const struct Output *)b)->fn);
+}
+
+/** @return The record of `out_fn`, or null. */
+static struct Output *output_find(const char *const out_fn) {
+	struct Output key;
+	if(!OutputArraySize(&manifest.outputs)) return 0;
+	key.fn = out_fn;
+	return bsearch(&key, OutputArrayGet(&manifest.outputs),
+		OutputArraySize(&manifest.outputs), sizeof key, &output_compare);
+}
+
+/** Breaks `manifest.file` into lines and parses them.
+ @return Whether it's in the format; if not, everything is forgotten.
+ @throws[realloc] */
+static int parse(void) {
+	char *line = CharArrayGet(&manifest.file), *next, *end;
+	struct Output *o;
+	struct Read *r;
+	const size_t version_len = strlen(manifest_version);
+	if(!line || strncmp(line, manifest_version, version_len)
+		|| line[version_len] != '\n') goto forget;
+	for(line += version_len + 1; *line; line = next) {
+		if(!(next = strchr(line, '\n'))) goto forget;
+		*next++ = '\0';
+		if(!strncmp(line, "output ", 7)) {
+			if(!(o = OutputArrayNew(&manifest.outputs))) return 0;
+			o->options = strtoul(line + 7, &end, 16);
+			if(*end != ' ') goto forget;
+			o->size = strtol(end + 1, &end, 10);
+			if(*end != ' ') goto forget;
+			o->fn = end + 1;
+			o->read = ReadArraySize(&manifest.reads), o->reads_no = 0;
+			o->is_replaced = 0;
+		} else if(!strncmp(line, "read ", 5)) {
+			if(!(o = OutputArrayPeek(&manifest.outputs))
+				|| !(r = ReadArrayNew(&manifest.reads))) goto forget;
+			r->size = strtol(line + 5, &end, 10);
+			if(*end != ' ') goto forget;
+			r->mtime = strtol(end + 1, &end, 10);
+			if(*end != ' ') goto forget;
+			r->hash = strtoul(end + 1, &end, 16);
+			if(*end != ' ') goto forget;
+			r->fn = end + 1;
+			o->reads_no++;
+		} else goto forget;
+	}
+	qsort(OutputArrayGet(&manifest.outputs), OutputArraySize(&manifest.outputs),
+		sizeof *o, &output_compare);
+	return 1;
+forget:
+	OutputArrayClear(&manifest.outputs);
+	ReadArrayClear(&manifest.reads);
+	errno = 0;
+	return 1;
+}
+
+/** Destructor for the manifest. */
+void Manifest_(void) {
+	CharArray_(&manifest.fn);
+	CharArray_(&manifest.file);
+	CharArray_(&manifest.next);
+	OutputArray_(&manifest.outputs);
+	ReadArray_(&manifest.reads);
+	manifest.is_loaded = 0;
+}
+
+/** Loads the manifest from it's file, forgetting the records that there
+ were; if there isn't one, or it's from another version, it's empty.
+ @return Success. @throws[fopen, fread, realloc] */
+static int load(void) {
+	const size_t granularity = 4096;
+	FILE *fp;
+	char *read_here, *terminating;
+	size_t nread;
+	int success = 0;
+	CharArrayClear(&manifest.file);
+	CharArrayClear(&manifest.next);
+	OutputArrayClear(&manifest.outputs);
+	ReadArrayClear(&manifest.reads);
+	if(!(fp = fopen(CharArrayGet(&manifest.fn), "r"))) { errno = 0; return 1; }
+	do {
+		if(!(read_here = CharArrayReserve(&manifest.file, granularity))
+			|| (nread = fread(read_here, 1, granularity, fp), ferror(fp))
+			|| (nread && !CharArrayBuffer(&manifest.file, nread)))
+			goto finally;
+	} while(nread == granularity);
+	if(!(terminating = CharArrayNew(&manifest.file))) goto finally;
+	*terminating = '\0';
+	success = parse();
+finally:
+	fclose(fp);
+	return success;
+}
+
+/** Loads the manifest from `fn`; if there isn't one, or it's from another
+ version, it's empty. Call before any threads use it.
+ @return Success. @throws[fopen, fread, realloc] */
+int Manifest(const char *const fn) {
+	const size_t fn_size = strlen(fn) + 1;
+	char *copy;
+	assert(fn);
+	Manifest_();
+	if(!(copy = CharArrayBuffer(&manifest.fn, fn_size))) return 0;
+	memcpy(copy, fn, fn_size);
+	manifest.is_loaded = 1;
+	return load();
+}
+
+/** Any thread can call this. `errno` is not changed. If it's current, the
+ files it was made from are in `Depend.h`.
+ @param[flags] The options that change the output.
+ @return Whether `out_fn` was made from `in_fn` with `flags` and none of the
+ files it read have changed since. */
+int ManifestIsCurrent(const char *const out_fn, const char *const in_fn,
+	const unsigned flags) {
+	const int e = errno;
+	const struct Output *o;
+	const struct Read *r, *r_end;
+	struct Read now;
+	int is_current = 0;
+	assert(manifest.is_loaded && out_fn && in_fn);
+	if(!(o = output_find(out_fn)) || o->options != options_hash(in_fn, flags))
+		goto finally;
+	file_stat(out_fn, &now);
+	if(now.size == -1 || now.size != o->size) goto finally;
+	for(r = ReadArrayGet(&manifest.reads) + o->read, r_end = r + o->reads_no;
+		r < r_end; r++) {
+		file_stat(r->fn, &now);
+		if(now.size != r->size) goto finally;
+		if(now.size == -1 || (r->mtime != -1 && now.mtime == r->mtime))
+			continue;
+		if(!file_hash(r->fn, &now.hash) || now.hash != r->hash) goto finally;
+	}
+	DependClear();
+	for(r = ReadArrayGet(&manifest.reads) + o->read; r < r_end; r++)
+		if(!DependAdd(r->fn)) goto finally;
+	is_current = 1;
+finally:
+	errno = e;
+	return is_current;
+}
+
+/** Appends `fn` and a newline to `a`, after `prefix`.
+ @return Success. @throws[realloc] */
+static int cat_line(struct CharArray *const a, const char *const prefix,
+	const char *const fn) {
+	const size_t prefix_len = strlen(prefix), fn_len = strlen(fn);
+	char *c;
+	if(!(c = CharArrayBuffer(a, prefix_len + fn_len + 1))) return 0;
+	memcpy(c, prefix, prefix_len), memcpy(c + prefix_len, fn, fn_len);
+	c[prefix_len + fn_len] = '\n';
+	return 1;
+}
+
+/** Puts the size, time, and hash of `fn` in `r`. If it's open as text, that's
+ what was read; otherwise, it's what's there now.
+ @return Success. @throws[open, mmap, fopen, fread] */
+static int file_read(const char *const fn, struct Read *const r) {
+	const struct Text *const text = TextFind(fn);
+	const long racy = (long)time(0) - 1;
+	if(text) {
+		const size_t size = TextSize(text) - 1; /* Without the `'\0'`. */
+		r->size = (long)size, r->mtime = TextTime(text);
+		r->hash = fnv(MANIFEST_FNV_BASIS, TextGet(text), size);
+		return 1;
+	}
+	file_stat(fn, r), r->hash = 0;
+	if(r->size != -1 && !file_hash(fn, &r->hash)) return 0;
+	if(r->mtime >= racy) r->mtime = -1;
+	return 1;
+}
+
+/** Records that `out_fn` was made from `in_fn` with `flags`, and read the
+ files that are in `Depend.h`. Any thread can call this, after the output is
+ closed. A file name with a newline can't be recorded, and it's output will
+ never be current.
+ @return Success. @throws[realloc, open, mmap, fopen, fread] */
+int ManifestRecord(const char *const out_fn, const char *const in_fn,
+	const unsigned flags) {
+	struct CharArray record;
+	struct Output *o;
+	struct Read now;
+	char prefix[128], *c;
+	size_t i;
+	int success = 0;
+	assert(manifest.is_loaded && out_fn && in_fn);
+	CharArray(&record);
+	if(strchr(out_fn, '\n')) return 1;
+	for(i = 0; i < DependSize(); i++)
+		if(strchr(DependGet(i), '\n')) return 1;
+	file_stat(out_fn, &now);
+	sprintf(prefix, "output %lx %ld ", options_hash(in_fn, flags), now.size);
+	if(!cat_line(&record, prefix, out_fn)) goto finally;
+	for(i = 0; i < DependSize(); i++) {
+		const char *const fn = DependGet(i);
+		if(!file_read(fn, &now)) goto finally;
+		sprintf(prefix, "read %ld %ld %lx ", now.size, now.mtime, now.hash);
+		if(!cat_line(&record, prefix, fn)) goto finally;
+	}
+#ifdef MANIFEST_POSIX
+	pthread_mutex_lock(&manifest_lock);
+#endif
+	if((o = output_find(out_fn))) o->is_replaced = 1;
+	if((c = CharArrayBuffer(&manifest.next, CharArraySize(&record))))
+		memcpy(c, CharArrayGet(&record), CharArraySize(&record)), success = 1;
+#ifdef MANIFEST_POSIX
+	pthread_mutex_unlock(&manifest_lock);
+#endif
+finally:
+	CharArray_(&record);
+	return success;
+}
+
+/** Saves the manifest where it was loaded from, with the new records. The
+ file is written next to it and renamed over it, so it's never half-written.
+ Then it's loaded again, so another run, (with `--watch`,) starts from what's
+ there now.
+ @return Success. @throws[fopen, fprintf, fwrite, rename, fread, realloc] */
+int ManifestWrite(void) {
+	struct CharArray temp;
+	const struct Output *o = 0;
+	const struct Read *r, *r_end;
+	FILE *fp = 0;
+	char *t;
+	const size_t fn_len = CharArraySize(&manifest.fn) - 1;
+	int success = 0;
+	assert(manifest.is_loaded);
+	CharArray(&temp);
+	if(!(t = CharArrayBuffer(&temp, fn_len + sizeof ".4294967295.tmp")))
+		goto finally;
+	memcpy(t, CharArrayGet(&manifest.fn), fn_len);
+	/* Another process writing the same manifest doesn't share the file. */
+#ifdef MANIFEST_POSIX
+	sprintf(t + fn_len, ".%lu.tmp", (unsigned long)getpid() & 0xffffffffUL);
+#else
+	memcpy(t + fn_len, ".tmp", sizeof ".tmp");
+#endif
+	if(!(fp = fopen(t, "w"))) goto finally;
+	fprintf(fp, "%s\n", manifest_version);
+	if(CharArraySize(&manifest.next)) fwrite(CharArrayGet(&manifest.next), 1,
+		CharArraySize(&manifest.next), fp);
+	/* The old records of outputs that weren't made again. */
+	while((o = OutputArrayNext(&manifest.outputs, o))) {
+		if(o->is_replaced) continue;
+		fprintf(fp, "output %lx %ld %s\n", o->options, o->size, o->fn);
+		for(r = ReadArrayGet(&manifest.reads) + o->read,
+			r_end = r + o->reads_no; r < r_end; r++)
+			fprintf(fp, "read %ld %ld %lx %s\n", r->size, r->mtime, r->hash,
+			r->fn);
+	}
+	if(ferror(fp)) goto finally;
+	if(fclose(fp) == EOF) { fp = 0; goto finally; }
+	fp = 0;
+#ifndef MANIFEST_POSIX
+	remove(CharArrayGet(&manifest.fn)); /* `rename` may not replace. */
+#endif
+	if(rename(t, CharArrayGet(&manifest.fn))) goto finally;
+	success = load();
+finally:
+	if(fp) fclose(fp);
+	CharArray_(&temp);
+	return success;
+}
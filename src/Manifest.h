@@ -0,0 +1,7 @@
+void Manifest_(void);
+int Manifest(const char *const fn);
+int ManifestIsCurrent(const char *const out_fn, const char *const in_fn,
+	const unsigned flags);
+int ManifestRecord(const char *const out_fn, const char *const in_fn,
+	const unsigned flags);
+int ManifestWrite(void);
@@ -1,13 +1,15 @@
 /** @license 2019 Neil Edelman, distributed under the terms of the
  [MIT License](https://opensource.org/licenses/MIT).
  
- If one calls <fn:Path>, helpful functions will be available until
+ If one calls <fn:Path>, helpful functions will be available on it until
  <fn:Path_>. */
 
+#include <stdlib.h>
 #include <stdio.h>
 #include <errno.h>
 #include <assert.h>
-#include "Path.h"
+#include "Cdoc.h"
+#include "Path.h" /** \include */
 
 #define ARRAY_NAME Path
 #define ARRAY_TYPE const char *
@@ -123,7 +125,7 @@ static int inverse_path(struct PathArray *const path,
 	/* The ".." is not an invertable operation; we may be lazy and require "."
 	 to not be there, too, then we can just count. */
 	while((p = PathArrayNext(inv, p))) if(strcmp(path_dot, *p) == 0
-		|| strcmp(path_twodots, *p) == 0) return fprintf(stderr,
+		|| strcmp(path_twodots, *p) == 0) return fprintf(CdocGetErr(),
 		"inverse_path: \"..\" is not surjective.\n"), 0;
 	if(!PathArrayReserve(path, inv_size)) return 0;
 	while((inv_size)) p = PathArrayNew(path), *p = path_twodots, inv_size--;
@@ -136,19 +138,12 @@ struct PathExtra {
 	struct PathArray path;
 };
 
-static struct {
+/** The directories of the input and output, and the working space. */
+struct Path {
 	struct PathExtra input, output, working;
 	struct PathArray outinv;
 	struct CharArray result;
-} paths;
-
-static void clear_paths(void) {
-	PathArray_(&paths.input.path), CharArray_(&paths.input.buffer);
-	PathArray_(&paths.output.path), CharArray_(&paths.output.buffer);
-	PathArray_(&paths.working.path), CharArray_(&paths.working.buffer);
-	PathArray_(&paths.outinv);
-	CharArray_(&paths.result);
-}
+};
 
 /** Helper for <fn:Path>. Puts `string` into `extra`. */
 static int extra_path(struct PathExtra *const extra, const char *const string) {
@@ -157,7 +152,7 @@ static int extra_path(struct PathExtra *const extra, const char *const string) {
 	assert(extra);
 	PathArrayClear(&extra->path), CharArrayClear(&extra->buffer);
 	if(!string) return 1;
-	if(!looks_like_path(string)) return fprintf(stderr,
+	if(!looks_like_path(string)) return fprintf(CdocGetErr(),
 		"%s: does not appear to be a path.\n", string), 1;
 	assert(strlen(string) < (size_t)-1);
 	string_size = strlen(string) + 1;
@@ -170,28 +165,55 @@ static int extra_path(struct PathExtra *const extra, const char *const string) {
 	return 1;
 }
 
-/** Clears all the data. */
-void Path_(void) { clear_paths(); }
+/** Clears all the data of `*ppath` and sets it to null. */
+void Path_(struct Path **const ppath) {
+	struct Path *p;
+	if(!ppath || !(p = *ppath)) return;
+	PathArray_(&p->input.path), CharArray_(&p->input.buffer);
+	PathArray_(&p->output.path), CharArray_(&p->output.buffer);
+	PathArray_(&p->working.path), CharArray_(&p->working.buffer);
+	PathArray_(&p->outinv);
+	CharArray_(&p->result);
+	free(p);
+	*ppath = 0;
+}
+
+/** Sets up `in_fn` and `out_fn` as directories for `p`, re-using it's
+ memory.
+ @return Success. @throws[malloc] */
+int PathSet(struct Path *const p, const char *const in_fn,
+	const char *const out_fn) {
+	assert(p);
+	return extra_path(&p->input, in_fn) && extra_path(&p->output, out_fn)
+		&& (inverse_path(&p->outinv, &p->output.path) || !errno);
+}
 
 /** Sets up `in_fn` and `out_fn` as directories for the path.
- @return Success. */
-int Path(const char *const in_fn, const char *const out_fn) {
-	if(!extra_path(&paths.input, in_fn) || !extra_path(&paths.output, out_fn)
-		|| (!inverse_path(&paths.outinv, &paths.output.path) && errno))
-		return clear_paths(), 0;
-	return 1;
+ @return A path that must be passed to <fn:Path_>, or null.
+ @throws[malloc] */
+struct Path *Path(const char *const in_fn, const char *const out_fn) {
+	struct Path *p;
+	if(!(p = malloc(sizeof *p))) return 0;
+	PathArray(&p->input.path), CharArray(&p->input.buffer);
+	PathArray(&p->output.path), CharArray(&p->output.buffer);
+	PathArray(&p->working.path), CharArray(&p->working.buffer);
+	PathArray(&p->outinv);
+	CharArray(&p->result);
+	if(!PathSet(p, in_fn, out_fn)) Path_(&p);
+	return p;
 }
 
-/** Helper; clobbers the working path buffer.
+/** Helper; clobbers the working path buffer of `p`.
  @return It may not set `errno` and return 0 if the path is messed. */
-static int append_working_path(const size_t fn_len, const char *const fn) {
+static int append_working_path(struct Path *const p, const size_t fn_len,
+	const char *const fn) {
 	char *workfn;
-	assert(fn);
-	CharArrayClear(&paths.working.buffer);
-	if(!(workfn = CharArrayBuffer(&paths.working.buffer, fn_len + 1))) return 0;
+	assert(p && fn);
+	CharArrayClear(&p->working.buffer);
+	if(!(workfn = CharArrayBuffer(&p->working.buffer, fn_len + 1))) return 0;
 	memcpy(workfn, fn, fn_len), workfn[fn_len] = '\0';
 	if(!looks_like_relative_path(workfn)
-		|| !sep_path(&paths.working.path, workfn)) return 0;
+		|| !sep_path(&p->working.path, workfn)) return 0;
 	return 1;
 }
 
@@ -216,36 +238,55 @@ static int looks_like_fragment(const size_t fn_len, const char *const fn) {
 	return !!strchr(path_subordinate, fn[0]);
 }
 
-/** Appends output directory to `fn`:`fn_name`, (if it exists.) For opening.
- @return A temporary path, invalid on calling any path function.
+/** Appends output directory of `p` to `fn`:`fn_name`, (if it exists.) For
+ opening.
+ @return A temporary path, invalid on calling any function on `p`.
  @throws[malloc] */
-const char *PathFromHere(const size_t fn_len, const char *const fn) {
+const char *PathFromHere(struct Path *const p, const size_t fn_len,
+	const char *const fn) {
+	assert(p);
 	if(looks_like_fragment(fn_len, fn)) return 0;
-	PathArrayClear(&paths.working.path);
-	if(!cat_path(&paths.working.path, &paths.input.path)
-		|| (fn && !append_working_path(strip_query_fragment(fn_len, fn), fn)))
-		return 0;
-	simplify_path(&paths.working.path);
-	return path_to_string(&paths.result, &paths.working.path);
+	PathArrayClear(&p->working.path);
+	if(!cat_path(&p->working.path, &p->input.path)
+		|| (fn && !append_working_path(p,
+		strip_query_fragment(fn_len, fn), fn))) return 0;
+	simplify_path(&p->working.path);
+	return path_to_string(&p->result, &p->working.path);
 }
 
-/** Appends inverse output directory and input directory to `fn`:`fn_name`, (if
- it exists.) It may return 0 if the path is weird, set `errno` before.
- @return A temporary path, invalid on calling any path function.
+/** Appends inverse output directory and input directory of `p` to
+ `fn`:`fn_name`, (if it exists.) It may return 0 if the path is weird, set
+ `errno` before.
+ @return A temporary path, invalid on calling any function on `p`.
  @throws[malloc] */
-const char *PathFromOutput(const size_t fn_len, const char *const fn) {
+const char *PathFromOutput(struct Path *const p, const size_t fn_len,
+	const char *const fn) {
+	assert(p);
 	/* If it's a absolute path to input, (that we've been given,) the best we
 	 could do is <fn:PathFromHere>. */
-	if(CharArraySize(&paths.input.buffer)
-		&& *CharArrayGet(&paths.input.buffer) == '\0')
-		return PathFromHere(fn_len, fn);
+	if(CharArraySize(&p->input.buffer)
+		&& *CharArrayGet(&p->input.buffer) == '\0')
+		return PathFromHere(p, fn_len, fn);
 	if(looks_like_fragment(fn_len, fn)) return 0;
-	PathArrayClear(&paths.working.path);
-	if(!cat_path(&paths.working.path, &paths.outinv)
-		|| !cat_path(&paths.working.path, &paths.input.path)
-		|| (fn && !append_working_path(fn_len, fn))) return 0;
-	simplify_path(&paths.working.path);
-	return path_to_string(&paths.result, &paths.working.path);
+	PathArrayClear(&p->working.path);
+	if(!cat_path(&p->working.path, &p->outinv)
+		|| !cat_path(&p->working.path, &p->input.path)
+		|| (fn && !append_working_path(p, fn_len, fn))) return 0;
+	simplify_path(&p->working.path);
+	return path_to_string(&p->result, &p->working.path);
+}
+
+/** @param[fn] Another output, from the working directory.
+ @return The path from the output directory of `p` to `fn`, or null if the
+ path is weird. It's temporary, invalid on calling any function on `p`.
+ @throws[malloc] */
+const char *PathToOutput(struct Path *const p, const char *const fn) {
+	assert(p && fn);
+	PathArrayClear(&p->working.path);
+	if(!cat_path(&p->working.path, &p->outinv)
+		|| !append_working_path(p, strlen(fn), fn)) return 0;
+	simplify_path(&p->working.path);
+	return path_to_string(&p->result, &p->working.path);
 }
 
 /** Is it a fragment? This accesses only the first character. */
@@ -1,8 +1,15 @@
-int Path(const char *const in_fn, const char *const out_fn);
-void Path_(void);
+struct Path;
+
+void Path_(struct Path **const ppath);
+struct Path *Path(const char *const in_fn, const char *const out_fn);
+int PathSet(struct Path *const p, const char *const in_fn,
+	const char *const out_fn);
 size_t PathStripQueryFragment(const char *const uri, const size_t uri_len);
-const char *PathFromHere(const size_t fn_len, const char *const fn);
-const char *PathFromOutput(const size_t fn_len, const char *const fn);
+const char *PathFromHere(struct Path *const p, const size_t fn_len,
+	const char *const fn);
+const char *PathFromOutput(struct Path *const p, const size_t fn_len,
+	const char *const fn);
+const char *PathToOutput(struct Path *const p, const char *const fn);
 int PathIsFragment(const char *const str);
 
 #define XSTR(s) STR(s)
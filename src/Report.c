@@ -2,9 +2,15 @@
  [MIT License](https://opensource.org/licenses/MIT).
 
  Organises tokens into sections, each section can have some documentation,
- code, and maybe attributes. */
-
-#include <string.h> /* size_t strncpy strncmp */
+ code, and maybe attributes. Everything about one translation unit is in a
+ <fn:Report>, which parsing passes around explicitly. Tokens only know the
+ index of their source, and the allocation functions that `Array.h` calls
+ have no context, so the public functions also bind the report to the thread
+ that calls them; that's how analysis and output find it. Different threads
+ can work on different reports. */
+
+#include <string.h> /* size_t strncpy strncmp strstr */
+#include <stdlib.h> /* malloc free */
 #include <limits.h> /* INT_MAX */
 #include <stdio.h>  /* .printf */
 #include "Division.h"
@@ -16,26 +22,58 @@
 #include "Path.h"
 #include "Text.h"
 #include "Style.h"
+#include "Sink.h"
 #include "ImageDimension.h"
 #include "Cdoc.h"
-#include "Report.h"
-
+#include "Arena.h"
+#include "Depend.h"
+#include "Catalog.h"
+#include "Cache.h"
+#include "ThreadLocal.h"
+#include "Report.h" /** \include */
+
+
+/** A file, or string, that tokens point into; `text` has the lines. */
+struct Source { const char *label, *buffer; const struct Text *text; };
+#define ARRAY_NAME Source
+#define ARRAY_TYPE struct Source
+#include "Array.h"
+/* The sources of the report bound to this thread. */
+static THREAD_LOCAL const struct SourceArray *sources;
 
-/** `Token` has a `Symbol` and is associated with an area of the text. */
+/** `Token` has a `Symbol` and is associated with an area of the text of
+ `file`, an index into `sources`. The line is not stored; it's only needed
+ for messages, so it's looked up then. Packed into 16 bytes, assuming 32-bit
+ `unsigned`. */
 struct Token {
-	enum Symbol symbol;
-	const char *from;
+	unsigned offset;
 	int length;
-	const char *label;
-	size_t line;
+	unsigned symbol;
+	unsigned file;
 };
+/** @return The start of the text of `t`. */
+static const char *token_from(const struct Token *const t) {
+	assert(t && sources && t->file < SourceArraySize(sources));
+	return SourceArrayGet(sources)[t->file].buffer + t->offset;
+}
+/** @return The line of `t` in it's file, or zero if it's not known.
+ @order \O(\log `lines`) */
+static size_t token_line(const struct Token *const t) {
+	assert(t && sources && t->file < SourceArraySize(sources));
+	return TextLine(SourceArrayGet(sources)[t->file].text, token_from(t));
+}
+/** @return The label of the file that `t` is from. */
+static const char *token_label(const struct Token *const t) {
+	assert(t && sources && t->file < SourceArraySize(sources));
+	return SourceArrayGet(sources)[t->file].label;
+}
 static void token_to_string(const struct Token *t, char (*const a)[12]) {
 	switch(t->symbol) {
 	case WORD: { int len = t->length >= 9 ? 9 : t->length;
-		sprintf(*a, "<%.*s>", len, t->from); break; }
+		sprintf(*a, "<%.*s>", len, token_from(t)); break; }
 	case DOC_ID:
 	case ID: { int len = t->length >= 8 ? 8 : t->length;
-		sprintf(*a, "ID:%.*s", len, t->from); break; }
+		sprintf(*a, "ID:%.*s", len, token_from(t)); break; }
 	case SPACE: { (*a)[0] = '~', (*a)[1] = '\0'; break; }
 	default:
 		strncpy(*a, symbols[t->symbol], sizeof *a - 1);
@@ -46,22 +84,26 @@ static void token_to_string(const struct Token *t, char (*const a)[12]) {
 static int token_compare(const struct Token *const a,
 	const struct Token *const b) {
 	const int len_cmp = (a->length > b->length) - (b->length > a->length);
-	const int str_cmp = strncmp(a->from, b->from,
+	const int str_cmp = strncmp(token_from(a), token_from(b),
 		len_cmp >= 0 ? b->length : a->length);
 	return str_cmp ? str_cmp : len_cmp;
 }
+/* `Token`, `Index`, and `Attribute` arrays are allocated from the arena of the
+ report and freed all at once by <fn:Report_>. */
 #define ARRAY_NAME Token
 #define ARRAY_TYPE struct Token
 #define ARRAY_TO_STRING &token_to_string
+#define ARRAY_REALLOC ArenaRealloc
+#define ARRAY_FREE ArenaFree
 #include "Array.h"
 /** This is used in `Semantic.c.re` to get the first file:line for error. */
 const char *TokensFirstLabel(const struct TokenArray *const tokens) {
 	const struct Token *const first = TokenArrayNext(tokens, 0);
-	return first ? first->label : "unlabelled";
+	return first ? token_label(first) : "unlabelled";
 }
 size_t TokensFirstLine(const struct TokenArray *const tokens) {
 	const struct Token *const first = TokenArrayNext(tokens, 0);
-	return first ? first->line : 0;
+	return first ? token_line(first) : 0;
 }
 /** This is used in `Semantic.c.re` to get the size of the string for
  `tokens`. */
@@ -89,6 +131,8 @@ static void index_to_string(const size_t *const n, char (*const a)[12]) {
 #define ARRAY_NAME Index
 #define ARRAY_TYPE size_t
 #define ARRAY_TO_STRING &index_to_string
+#define ARRAY_REALLOC ArenaRealloc
+#define ARRAY_FREE ArenaFree
 #include "Array.h"
 
 
@@ -107,6 +151,8 @@ static void attribute_to_string(const struct Attribute *t, char (*const a)[12])
 #define ARRAY_NAME Attribute
 #define ARRAY_TYPE struct Attribute
 #define ARRAY_TO_STRING &attribute_to_string
+#define ARRAY_REALLOC ArenaRealloc
+#define ARRAY_FREE ArenaFree
 #include "../src/Array.h"
 static void attributes_(struct AttributeArray *const atts) {
 	struct Attribute *a;
@@ -124,6 +170,12 @@ struct Segment {
 	struct TokenArray doc, code;
 	struct IndexArray code_params;
 	struct AttributeArray attributes;
+	/* The title, `code[code_params[0]]`, memoised by <fn:segment_label>:
+	 offsets of the raw and HTML-escaped strings in the label pool and the
+	 hash of the raw string. */
+	int is_labelled;
+	size_t label, html_label;
+	unsigned hash;
 };
 /** Provides a default token for `segment` to print. */
 static const struct Token *segment_fallback(const struct Segment *const segment,
@@ -191,7 +243,7 @@ static void erase_segment(struct Segment *const segment) {
 	TokenArray_(&segment->doc);
 	TokenArray_(&segment->code);
 	if(CdocGetDebug() & DBG_ERASE && IndexArraySize(&segment->code_params))
-		fprintf(stderr, "*** Erasing %s: %s.\n",
+		fprintf(CdocGetErr(), "*** Erasing %s: %s.\n",
 		a, IndexArrayToString(&segment->code_params));
 	IndexArray_(&segment->code_params);
 	attributes_(&segment->attributes);
@@ -200,12 +252,6 @@ static void erase_segment(struct Segment *const segment) {
 #define ARRAY_TYPE struct Segment
 #define ARRAY_TO_STRING &segment_to_string
 #include "../src/Array.h"
-static void segment_array_(struct SegmentArray *const sa) {
-	struct Segment *segment;
-	if(!sa) return;
-	while((segment = SegmentArrayPop(sa))) erase_segment(segment);
-	SegmentArray_(sa);
-}
 /*static void segment_array_clear(struct SegmentArray *const sa) {
 	struct Segment *segment;
 	if(!sa) return;
@@ -224,7 +270,8 @@ static const struct Token *param_no(const struct Segment *const segment,
 	if(*pidx >= TokenArraySize(&segment->code)) {
 		char a[12];
 		segment_to_string(segment, &a);
-		fprintf(stderr, "%s: param index %lu is greater then code size.\n",
+		fprintf(CdocGetErr(),
+			"%s: param index %lu is greater then code size.\n",
 			a, (unsigned long)TokenArraySize(&segment->code));
 		return 0;
 	}
@@ -233,28 +280,131 @@ static const struct Token *param_no(const struct Segment *const segment,
 
 
 
-/** Top-level static document. */
-static struct SegmentArray report;
-static struct TokenArray brief;
+/* Memoised labels of segments, referenced by offset. */
+#define ARRAY_NAME Label
+#define ARRAY_TYPE char
+#include "Array.h"
+
+/* Open addressing; one plus the index of the segment in `segments`, or zero if
+ empty. */
+#define ARRAY_NAME Bucket
+#define ARRAY_TYPE size_t
+#include "Array.h"
+
+/* Where the symbols from the scanner go; this is kept across includes. */
+struct Sorter {
+	enum { S_CODE, S_DOC, S_ARGS } state;
+	size_t last_doc_line; /* Of the last `DOC_END`, or zero. */
+	struct Segment *segment;
+	struct Attribute *attribute;
+	unsigned space, newline;
+	int is_code_ignored, is_semantic_set;
+};
+
+/** The document of a translation unit and the context to parse it. */
+struct Report {
+	const char *in_fn, *out_fn; /* The title, and the output, or null. */
+	struct Arena *arena;
+	struct SourceArray sources;
+	struct SegmentArray segments;
+	struct Sorter sorter;
+	struct {
+		int is_valid;
+		struct LabelArray labels;
+		struct BucketArray buckets;
+	} index;
+	struct Semantic *semantic;
+	struct Path *path;
+	char oops[128]; /* <fn:oops> writes here. */
+};
+
+/* The report that this thread is working on. */
+static THREAD_LOCAL struct Report *report;
+
+/** Puts `sorter` in the state of the start of a file. */
+static void sorter_reset(struct Sorter *const sorter) {
+	sorter->state = S_CODE, sorter->last_doc_line = 0;
+	sorter->segment = 0, sorter->attribute = 0;
+	sorter->space = sorter->newline = 0;
+	sorter->is_code_ignored = sorter->is_semantic_set = 0;
+}
+
+/** Binds `r`, which can be null, and it's arena to this thread. */
+static void report_use(struct Report *const r) {
+	report = r;
+	sources = r ? &r->sources : 0;
+	ArenaUse(r ? r->arena : 0);
+}
 
+#include "ReportIndex.h"
+
+
+
+/** Destructor for the document `*pr`; sets it to null. Everything that the
+ segments own is in the arena. */
+void Report_(struct Report **const pr) {
+	struct Report *r;
+	if(!pr || !(r = *pr)) return;
+	report_use(r);
+	SegmentArray_(&r->segments);
+	SourceArray_(&r->sources);
+	index_(r);
+	Semantic_(&r->semantic);
+	Path_(&r->path);
+	Arena_(&r->arena);
+	report_use(0);
+	free(r);
+	*pr = 0;
+}
 
+/** @param[in_fn, out_fn] Files that the paths are relative to; either can be
+ null. `in_fn` is also the title, so must be valid until output.
+ @return A new empty report, that must be passed to <fn:Report_>, or null.
+ @throws[malloc] */
+struct Report *Report(const char *const in_fn, const char *const out_fn) {
+	struct Report *r;
+	if(!(r = malloc(sizeof *r))) return 0;
+	r->in_fn = in_fn, r->out_fn = out_fn;
+	r->arena = 0, r->semantic = 0, r->path = 0;
+	SourceArray(&r->sources);
+	SegmentArray(&r->segments);
+	sorter_reset(&r->sorter);
+	r->index.is_valid = 0;
+	LabelArray(&r->index.labels);
+	BucketArray(&r->index.buckets);
+	r->oops[0] = '\0';
+	if(!(r->arena = Arena()) || !(r->semantic = Semantic())
+		|| !(r->path = Path(in_fn, out_fn))) Report_(&r);
+	return r;
+}
 
-/** Destructor for the static document. Also destucts the string used for
- tokens. */
-void Report_(void) {
-	TokenArray_(&brief);
-	segment_array_(&report);
-	Semantic(0);
-	Style_();
+/** Empties `r` for another translation unit, like a new <fn:Report>, but the
+ memory that `r` has is kept for the new one.
+ @return Success, otherwise `r` has to be cleared again before it's used.
+ @throws[malloc] */
+int ReportClear(struct Report *const r, const char *const in_fn,
+	const char *const out_fn) {
+	assert(r);
+	report_use(r);
+	r->in_fn = in_fn, r->out_fn = out_fn;
+	SegmentArrayClear(&r->segments);
+	SourceArrayClear(&r->sources);
+	sorter_reset(&r->sorter);
+	index_clear(r);
+	r->oops[0] = '\0';
+	ArenaClear(r->arena);
+	return PathSet(r->path, in_fn, out_fn);
 }
 
-/** @return A new empty segment from `segments`, defaults to the preamble, or
- null on error. */
-static struct Segment *new_segment(struct SegmentArray *const segments) {
+/** @return A new empty segment in `r`, defaults to the preamble, or null on
+ error. */
+static struct Segment *new_segment(struct Report *const r) {
 	struct Segment *segment;
-	assert(segments);
-	if(!(segment = SegmentArrayNew(segments))) return 0;
+	assert(r);
+	if(!(segment = SegmentArrayNew(&r->segments))) return 0;
 	segment->division = DIV_PREAMBLE; /* Default. */
+	segment->is_labelled = 0;
+	index_invalidate(r);
 	TokenArray(&segment->doc);
 	TokenArray(&segment->code);
 	IndexArray(&segment->code_params);
@@ -262,66 +412,91 @@ static struct Segment *new_segment(struct SegmentArray *const segments) {
 	return segment;
 }
 
-/** Initialises `token` with `scan`.
+/** Sets `file` to the index of `label` and `buffer`, which has the lines in
+ `text`, in the sources of `r`. Only the last is checked, so a file that is
+ interrupted by an include will get another index when it resumes.
+ @return Success. @throws[realloc] */
+static int source_index(struct Report *const r, const char *const label,
+	const char *const buffer, const struct Text *const text,
+	unsigned *const file) {
+	struct Source *source = SourceArrayPeek(&r->sources);
+	assert(r && label && buffer && file);
+	if(!source || source->label != label || source->buffer != buffer) {
+		if(SourceArraySize(&r->sources) >= UINT_MAX
+			|| !(source = SourceArrayNew(&r->sources))) return 0;
+		source->label = label, source->buffer = buffer, source->text = text;
+	}
+	*file = (unsigned)(SourceArraySize(&r->sources) - 1);
+	return 1;
+}
+
+/** Initialises `token` with `st` from the scanner with `file` in the bound
+ `sources`.
  @return Success.
- @throws[EILSEQ] The token cannot be represented as an `int` offset. */
-static int init_token(struct Token *const token,
-	const struct Scanner *const scan) {
-	const char *const from = ScannerFrom(scan), *const to = ScannerTo(scan);
-	assert(scan && token && from && from <= to);
-	if(from + INT_MAX < to) return errno = EILSEQ, 0;
-	token->symbol = ScannerSymbol(scan);
-	token->from = from;
-	token->length = (int)(to - from);
-	token->label = ScannerLabel(scan);
-	token->line = ScannerLine(scan);
+ @throws[EILSEQ] The token cannot be represented as an `unsigned` offset and
+ `int` length. */
+static int init_token(struct Token *const token, const unsigned file,
+	const struct ScannerToken *const st) {
+	const char *buffer;
+	assert(token && sources && file < SourceArraySize(sources)
+		&& st && st->from && st->from <= st->to);
+	buffer = SourceArrayGet(sources)[file].buffer;
+	if(st->from + INT_MAX < st->to || buffer > st->from
+		|| (size_t)(st->from - buffer) > UINT_MAX) return errno = EILSEQ, 0;
+	token->offset = (unsigned)(st->from - buffer);
+	token->length = (int)(st->to - st->from);
+	token->symbol = (unsigned)st->symbol;
+	token->file = file;
 	return 1;
 }
 
 /** @return A new `Attribute` on `segment` with `symbol`, (should be a
  attribute symbol.) Null on error. */
 static struct Attribute *new_attribute(struct Segment *const segment,
-	const struct Scanner *const scan) {
+	const unsigned file, const struct ScannerToken *const st) {
 	struct Attribute *att;
-	assert(scan && segment);
+	assert(segment && st);
 	if(!(att = AttributeArrayNew(&segment->attributes))) return 0;
-	init_token(&att->token, scan);
+	init_token(&att->token, file, st);
 	TokenArray(&att->header);
 	TokenArray(&att->contents);
 	return att;
 }
 
-/** Creates a new token from `tokens` and fills it with `symbol` and the
- most recent scanner location.
+/** Creates a new token from `tokens` and fills it with the symbol and
+ location of `st` from the scanner with `file` in `sources`.
  @return Token or failure. */
 static struct Token *new_token(struct TokenArray *const tokens,
-	const struct Scanner *const scan) {
+	const unsigned file, const struct ScannerToken *const st) {
 	struct Token *token;
 	if(!(token = TokenArrayNew(tokens))) return 0;
-	init_token(token, scan);
-	/*fprintf(stderr, "new_token: %s %.*s\n", symbols[token->symbol],
-		token->length, token->from); <- If one really wants spam. */
+	if(!init_token(token, file, st)) { TokenArrayPop(tokens); return 0; }
+	/*fprintf(CdocGetErr(), "new_token: %s %.*s\n", symbols[token->symbol],
+		token->length, token_from(token)); <- If one really wants spam. */
 	return token;
 }
 
-/** Wrapper for `Semantic.h`; extracts semantic information from `segment`. */
-static int report_semantic(struct Segment *const segment) {
+/** Wrapper for `Semantic.h`; extracts semantic information from `segment` with
+ the analyser of `r`. */
+static int report_semantic(struct Report *const r,
+	struct Segment *const segment) {
 	size_t no, i;
 	const size_t *source;
 	size_t *dest;
+	assert(r);
 	if(!segment) return 0;
-	if(!Semantic(&segment->code)) return 0;
-	segment->division = SemanticDivision();
+	if(!SemanticParse(r->semantic, &segment->code)) return 0;
+	segment->division = SemanticDivision(r->semantic);
 	/* Copy `Semantic` size array to this size array,
 	 (not the same, local scope; kind of a hack.) */
-	SemanticParams(&no, &source);
+	SemanticParams(r->semantic, &no, &source);
 	if(!no) return 1; /* We will cull them later. */
 	if(!(dest = IndexArrayBuffer(&segment->code_params, no))) return 0;
 	for(i = 0; i < no; i++) dest[i] = source[i];
 	if(CdocGetDebug() & DBG_ERASE) {
 		char a[12];
 		segment_to_string(segment, &a);
-		fprintf(stderr, "*** Adding %lu to %s: %s.\n",
+		fprintf(CdocGetErr(), "*** Adding %lu to %s: %s.\n",
 			(unsigned long)no, a, IndexArrayToString(&segment->code_params));
 	}
 	return 1;
@@ -329,25 +504,27 @@ static int report_semantic(struct Segment *const segment) {
 
 
 
-/** Prints `segment` to `stderr`. */
+/** Prints `segment` to `CdocGetErr()`. */
 static void print_segment_debug(const struct Segment *const segment) {
 	struct Attribute *att = 0;
 	struct Token *doc, *code;
 	if(!(CdocGetDebug() & DBG_OUTPUT)) return;
 	code = TokenArrayNext(&segment->code, 0);
 	doc  = TokenArrayNext(&segment->doc,  0);
-	fprintf(stderr, "Segment division %s:\n"
+	fprintf(CdocGetErr(), "Segment division %s:\n"
 		"%s:%lu code: %s;\n"
 		"of which params: %s;\n"
 		"%s:%lu doc: %s.\n",
 		divisions[segment->division],
-		code ? code->label : "N/A", code ? code->line : 0,
+		code ? token_label(code) : "N/A",
+		code ? (unsigned long)token_line(code) : 0ul,
 		TokenArrayToString(&segment->code),
 		IndexArrayToString(&segment->code_params),
-		doc ? doc->label : "N/A", doc ? doc->line : 0,
+		doc ? token_label(doc) : "N/A",
+		doc ? (unsigned long)token_line(doc) : 0ul,
 		TokenArrayToString(&segment->doc));
 	while((att = AttributeArrayNext(&segment->attributes, att)))
-		fprintf(stderr, "%s{%s} %s.\n", symbols[att->token.symbol],
+		fprintf(CdocGetErr(), "%s{%s} %s.\n", symbols[att->token.symbol],
 		TokenArrayToString(&att->header),
 		TokenArrayToString(&att->contents));
 }
@@ -362,211 +539,269 @@ static void cut_segment_here(struct Segment **const psegment) {
 	*psegment = 0;
 }
 
-/** Prints line info into a static buffer. */
-static const char *oops(const struct Scanner *const scan) {
-	static char p[128];
-	assert(scan);
-	sprintf(p, "%.32s:%lu, %s", ScannerLabel(scan),
-		(unsigned long)ScannerLine(scan), symbols[ScannerSymbol(scan)]);
-	return p;
+/** @return The line of `st` from the scanner with `file` in the sources of
+ `r`. @order \O(\log `lines`) */
+static size_t source_line(const struct Report *const r, const unsigned file,
+	const struct ScannerToken *const st) {
+	assert(r && file < SourceArraySize(&r->sources) && st);
+	return TextLine(SourceArrayGet(&r->sources)[file].text, st->from);
+}
+
+/** Prints line info about `st` from the scanner with `file` into the buffer
+ of `r`. */
+static const char *oops(struct Report *const r, const unsigned file,
+	const struct ScannerToken *const st) {
+	assert(r && file < SourceArraySize(&r->sources) && st);
+	sprintf(r->oops, "%.32s:%lu, %s",
+		SourceArrayGet(&r->sources)[file].label,
+		(unsigned long)source_line(r, file, st), symbols[st->symbol]);
+	return r->oops;
 }
 
-void ReportLastSegmentDebug(void) {
-	const struct Segment *const segment = SegmentArrayBack(&report, 0);
-	if(!segment) return;
+void ReportLastSegmentDebug(struct Report *const r) {
+	const struct Segment *segment;
+	if(!r) return;
+	report_use(r);
+	if(!(segment = SegmentArrayBack(&r->segments, 0))) return;
 	print_segment_debug(segment);
 }
 
-/** This appends the current token based on the state it was last in.
+/** This appends `st`, which is from `scan`, to `r`, based on the state it was
+ last in. Local includes are handled by <fn:ReportScan>.
  @return Success. */
-int ReportNotify(const struct Scanner *const scan) {
-	const enum Symbol symbol = ScannerSymbol(scan);
+static int notify(struct Report *const r, struct Scanner *const scan,
+	const unsigned file, const struct ScannerToken *const st) {
+	struct Sorter *const sorter = &r->sorter;
+	const enum Symbol symbol = st->symbol;
 	const char symbol_mark = symbol_marks[symbol];
 	int is_differed_cut = 0;
-	static struct {
-		enum { S_CODE, S_DOC, S_ARGS } state;
-		size_t last_doc_line;
-		struct Segment *segment;
-		struct Attribute *attribute;
-		unsigned space, newline;
-		int is_code_ignored, is_semantic_set;
-	} sorter = { 0, 0, 0, 0, 0, 0, 0, 0 };
 	/* These symbols require special consideration. */
 	switch(symbol) {
 	case DOC_BEGIN:
-		if(sorter.state != S_CODE) return fprintf(stderr,
+		if(sorter->state != S_CODE) return fprintf(CdocGetErr(),
 			"%s: sneak path; was expecting code.\n",
-			oops(scan)), errno = EDOM, 0;
-		sorter.state = S_DOC;
+			oops(r, file, st)), errno = EDOM, 0;
+		sorter->state = S_DOC;
 		/* Reset attribute. */
-		sorter.attribute = 0;
+		sorter->attribute = 0;
 		/* Two docs on top of each other without code, the top one belongs to
 		 the preamble. */
-		if(sorter.segment && !TokenArraySize(&sorter.segment->code))
-			cut_segment_here(&sorter.segment);
+		if(sorter->segment && !TokenArraySize(&sorter->segment->code))
+			cut_segment_here(&sorter->segment);
 		return 1;
 	case DOC_END:
-		if(sorter.state != S_DOC) return fprintf(stderr,
+		if(sorter->state != S_DOC) return fprintf(CdocGetErr(),
 			"%s: sneak path; was expecting doc.\n",
-			oops(scan)), errno = EDOM, 0;
-		sorter.state = S_CODE;
-		sorter.last_doc_line = ScannerLine(scan);
+			oops(r, file, st)), errno = EDOM, 0;
+		sorter->state = S_CODE;
+		sorter->last_doc_line = source_line(r, file, st);
 		return 1;
 	case DOC_LEFT:
-		if(sorter.state != S_DOC || !sorter.segment || !sorter.attribute)
-			return fprintf(stderr,
-			"%s: sneak path; was expecting doc with attribute.\n", oops(scan)),
+		if(sorter->state != S_DOC || !sorter->segment || !sorter->attribute)
+			return fprintf(CdocGetErr(),
+			"%s: sneak path; was expecting doc with attribute.\n",
+			oops(r, file, st)),
 			errno = EDOM, 0;
-		sorter.state = S_ARGS;
+		sorter->state = S_ARGS;
 		return 1;
 	case DOC_RIGHT:
-		if(sorter.state != S_ARGS || !sorter.segment || !sorter.attribute)
-			return fprintf(stderr,
-			"%s: sneak path; was expecting args with attribute.\n", oops(scan)),
+		if(sorter->state != S_ARGS || !sorter->segment || !sorter->attribute)
+			return fprintf(CdocGetErr(),
+			"%s: sneak path; was expecting args with attribute.\n",
+			oops(r, file, st)),
 			errno = EDOM, 0;
-		sorter.state = S_DOC;
+		sorter->state = S_DOC;
 		return 1;
 	case DOC_COMMA: /* @arg[,,] */
-		if(sorter.state != S_ARGS || !sorter.segment || !sorter.attribute)
-			return fprintf(stderr,
-			"%s: sneak path; was expecting args with attribute.\n", oops(scan)),
+		if(sorter->state != S_ARGS || !sorter->segment || !sorter->attribute)
+			return fprintf(CdocGetErr(),
+			"%s: sneak path; was expecting args with attribute.\n",
+			oops(r, file, st)),
 			errno = EDOM, 0;
 		return 1;
-	case SPACE:   sorter.space++; return 1;
-	case NEWLINE: sorter.newline++; return 1;
+	case SPACE:   sorter->space++; return 1;
+	case NEWLINE: sorter->newline++; return 1;
 	case SEMI:
 		/* Break on global semicolons only. */
-		if(ScannerIndentLevel(scan) != 0 || !sorter.segment) break;
+		if(st->indent_level != 0 || !sorter->segment) break;
 		/* Find out what this line means if one hasn't already. */
-		if(!sorter.is_semantic_set && !report_semantic(sorter.segment)) return 0;
-		sorter.is_semantic_set = 1;
+		if(!sorter->is_semantic_set && !report_semantic(r, sorter->segment))
+			return 0;
+		sorter->is_semantic_set = 1;
 		is_differed_cut = 1;
 		break;
 	case LBRACE:
 		/* If it's a leading brace, see what the Semantic says about it. */
-		if(ScannerIndentLevel(scan) != 1 || sorter.is_semantic_set
-			|| !sorter.segment) break;
-		if(!report_semantic(sorter.segment)) return 0;
-		sorter.is_semantic_set = 1;
-		if(sorter.segment->division == DIV_FUNCTION) sorter.is_code_ignored = 1;
+		if(st->indent_level != 1 || sorter->is_semantic_set
+			|| !sorter->segment) break;
+		if(!report_semantic(r, sorter->segment)) return 0;
+		sorter->is_semantic_set = 1;
+		/* The scanner doesn't need to go though the function body. */
+		if(sorter->segment->division == DIV_FUNCTION)
+			sorter->is_code_ignored = 1, ScannerIgnoreBlock(scan);
 		break;
 	case RBRACE:
 		/* Functions don't have ';' to end them. */
-		if(ScannerIndentLevel(scan) != 0 || !sorter.segment) break;
-		if(sorter.segment->division == DIV_FUNCTION) is_differed_cut = 1;
+		if(st->indent_level != 0 || !sorter->segment) break;
+		if(sorter->segment->division == DIV_FUNCTION) is_differed_cut = 1;
 		break;
-	case LOCAL_INCLUDE: /* Include file. */
-		assert(sorter.state == S_CODE);
-		{
-			const char *fn = 0;
-			struct Scanner *subscan = 0;
-			struct Text *text = 0;
-			int success = 0;
-			if(!(fn = PathFromHere(ScannerTo(scan) - ScannerFrom(scan),
-				ScannerFrom(scan)))) goto include_catch;
-			if(!(text = TextOpen(fn))) goto include_catch;
-			cut_segment_here(&sorter.segment);
-			if(!(subscan = Scanner(TextBaseName(text), TextGet(text),
-				&ReportNotify, SSCODE))) goto include_catch;
-			cut_segment_here(&sorter.segment);
-			success = 1;
-			goto include_finally;
-include_catch:
-			if(errno) perror("including");
-			else fprintf(stderr, "%s: couldn't resolve name.\n", oops(scan));
-include_finally:
-			Scanner_(&subscan);
-			return success;
-		}
 	default: break;
 	}
 
-	/* Code that starts far away from docs goes in it's own segment. */
-	if(sorter.segment && symbol_mark != '~' && symbol_mark != '@'
-		&& !TokenArraySize(&sorter.segment->code) && sorter.last_doc_line
-		&& sorter.last_doc_line + 2 < ScannerLine(scan))
-		cut_segment_here(&sorter.segment);
+	/* Code that starts far away from docs goes in it's own segment; the line
+	 is only looked up for the first code after a doc. */
+	if(sorter->segment && symbol_mark != '~' && symbol_mark != '@'
+		&& !TokenArraySize(&sorter->segment->code) && sorter->last_doc_line
+		&& sorter->last_doc_line + 2 < source_line(r, file, st))
+		cut_segment_here(&sorter->segment);
 
 	/* Make a new segment if needed. */
-	if(!sorter.segment) {
-		if(!(sorter.segment = new_segment(&report))) return 0;
-		sorter.attribute = 0;
-		sorter.space = sorter.newline = 0;
-		sorter.is_code_ignored = sorter.is_semantic_set = 0;
+	if(!sorter->segment) {
+		if(!(sorter->segment = new_segment(r))) return 0;
+		sorter->attribute = 0;
+		sorter->space = sorter->newline = 0;
+		sorter->is_code_ignored = sorter->is_semantic_set = 0;
 	}
 
 	/* Make a `token` where the context places us. */
 	switch(symbol_mark) {
 	case '~': /* General docs. */
-		assert(sorter.state == S_DOC || sorter.state == S_ARGS);
+		assert(sorter->state == S_DOC || sorter->state == S_ARGS);
 		{ /* This lazily places whitespace and newlines. */
-			struct TokenArray *selected = sorter.attribute
-				? (sorter.state == S_ARGS ? &sorter.attribute->header
-				: &sorter.attribute->contents) : &sorter.segment->doc;
+			struct TokenArray *selected = sorter->attribute
+				? (sorter->state == S_ARGS ? &sorter->attribute->header
+				: &sorter->attribute->contents) : &sorter->segment->doc;
 			struct Token *tok;
-			const int is_para = sorter.newline > 1,
-				is_space = sorter.space || sorter.newline,
-				is_doc_empty = !TokenArraySize(&sorter.segment->doc),
+			const int is_para = sorter->newline > 1,
+				is_space = sorter->space || sorter->newline,
+				is_doc_empty = !TokenArraySize(&sorter->segment->doc),
 				is_selected_empty = !TokenArraySize(selected);
-			sorter.space = sorter.newline = 0;
+			sorter->space = sorter->newline = 0;
 			if(is_para) {
 				/* Switch out of attribute when on new paragraph. */
-				sorter.attribute = 0, sorter.state = S_DOC;
-				selected = &sorter.segment->doc;
+				sorter->attribute = 0, sorter->state = S_DOC;
+				selected = &sorter->segment->doc;
 				if(!is_doc_empty) {
-					if(!(tok = new_token(selected, scan))) return 0;
+					if(!(tok = new_token(selected, file, st))) return 0;
 					tok->symbol = NEWLINE; /* Override whatever's there. */
 				}
 			} else if(is_space && !is_selected_empty) {
-				if(!(tok = new_token(selected, scan))) return 0;
+				if(!(tok = new_token(selected, file, st))) return 0;
 				tok->symbol = SPACE; /* Override. */
 			}
-			if(!new_token(selected, scan)) return 0;
+			if(!new_token(selected, file, st)) return 0;
 		}
 		break;
 	case '@': /* An attribute marker. */
-		assert(sorter.state == S_DOC);
-		if(!(sorter.attribute = new_attribute(sorter.segment, scan)))
+		assert(sorter->state == S_DOC);
+		if(!(sorter->attribute = new_attribute(sorter->segment, file, st)))
 			return 0;
-		sorter.space = sorter.newline = 0; /* Also reset this for attributes. */
+		/* Also reset this for attributes. */
+		sorter->space = sorter->newline = 0;
 		break;
 	default: /* Code. */
-		assert(sorter.state == S_CODE);
-		if(sorter.is_code_ignored) break;
-		if(!new_token(&sorter.segment->code, scan)) return 0;
+		assert(sorter->state == S_CODE);
+		if(sorter->is_code_ignored) break;
+		if(!new_token(&sorter->segment->code, file, st)) return 0;
 		break;
 	}
 
 	/* End the segment. */
-	if(is_differed_cut) cut_segment_here(&sorter.segment);
+	if(is_differed_cut) cut_segment_here(&sorter->segment);
 
 	return 1;
 }
 
-/** Used for temporary things in doc mode.
- @fixme Memory leak. See <fn:new_token>. */
-static int notify_brief(const struct Scanner *const scan) {
-	struct Token *tok;
-	assert(scan);
-	/* `brief` is just documentation; no code. */
-	if(!(tok = new_token(&brief, scan))) fprintf(stderr,
-		"%s: something went wrong with this operation.\n", oops(scan)), 0;
+#define ARRAY_NAME Scanner
+#define ARRAY_TYPE struct Scanner *
+#define ARRAY_STACK
+#include "Array.h"
+
+/** Pushes a new scanner on `stack` for `text`. If only documentation is
+ wanted, texts without any are not scanned at all.
+ @return Success. @throws[malloc] */
+static int push_scanner(struct ScannerArray *const stack,
+	struct Text *const text) {
+	struct Scanner **top;
+	assert(stack && text);
+	if(CdocGetDocOnly() && !strstr(TextGet(text), "/**")) return 1;
+	if(!(top = ScannerArrayNew(stack))) return 0;
+	if(!(*top = Scanner(TextBaseName(text), TextGet(text), 0, 0, SSCODE)))
+		return ScannerArrayPop(stack), 0;
+	ScannerLineIndex(*top, text);
+	if(CdocGetDocOnly()) ScannerDocOnly(*top);
 	return 1;
 }
 
+/** Scans `text` into `r` a batch at a time. Local includes are scanned in
+ place, using a stack instead of recursion.
+ @return Success.
+ @throws[malloc, fopen, fread, EILSEQ] */
+int ReportScan(struct Report *const r, struct Text *const text) {
+	struct ScannerArray stack;
+	struct Scanner **top;
+	struct ScannerToken batch[256], *st, *st_end;
+	struct Text *include;
+	const char *fn;
+	unsigned file;
+	int success = 0;
+	assert(r);
+	ScannerArray(&stack);
+	report_use(r);
+	errno = 0;
+	if(!DependAdd(TextName(text)) || !push_scanner(&stack, text)) goto catch;
+	while((top = ScannerArrayPeek(&stack))) {
+		const size_t batch_size
+			= ScannerBatch(*top, batch, sizeof batch / sizeof *batch);
+		if(!batch_size) {
+			if(errno) goto catch;
+			Scanner_(top), ScannerArrayPop(&stack);
+			/* An include is it's own segment. */
+			if(ScannerArraySize(&stack)) cut_segment_here(&r->sorter.segment);
+			continue;
+		}
+		if(!source_index(r, ScannerLabel(*top), ScannerBuffer(*top),
+			ScannerText(*top), &file)) goto catch;
+		for(st = batch, st_end = batch + batch_size; st < st_end; st++)
+			if(st->symbol != LOCAL_INCLUDE && !notify(r, *top, file, st))
+				goto catch;
+		/* A local include can only be at the end of a batch. */
+		if((st = st_end - 1)->symbol != LOCAL_INCLUDE) continue;
+		assert(r->sorter.state == S_CODE);
+		if(!(fn = PathFromHere(r->path, (size_t)(st->to - st->from),
+			st->from))) {
+			if(!errno) fprintf(CdocGetErr(), "%s: couldn't resolve name.\n",
+				oops(r, file, st));
+			goto catch;
+		}
+		if(!DependAdd(fn) || !(include = TextOpen(fn))) goto catch;
+		cut_segment_here(&r->sorter.segment);
+		if(!push_scanner(&stack, include)) goto catch;
+	}
+	success = 1;
+	goto finally;
+catch:
+	if(errno) CdocPerror(ScannerArrayPeek(&stack)
+		? ScannerLabel(*ScannerArrayPeek(&stack)) : TextBaseName(text));
+finally:
+	while((top = ScannerArrayPop(&stack))) Scanner_(top);
+	ScannerArray_(&stack);
+	return success;
+}
+
 /* Output. */
 
-/** Prints line info in a static buffer, (to be printed?) */
+/** Prints line info in a static buffer for the thread, (to be printed?) */
 static const char *pos(const struct Token *const token) {
-	static char p[128];
+	static THREAD_LOCAL char p[128];
 	if(!token) {
 		sprintf(p, "Unknown position in report");
 	} else {
 		const int max_size = 16,
 			tok_len = (token->length > max_size) ? max_size : token->length;
-		sprintf(p, "%.32s:%lu, %s \"%.*s\"", token->label,
-			(unsigned long)token->line, symbols[token->symbol], tok_len,
-			token->from);
+		sprintf(p, "%.32s:%lu, %s \"%.*s\"", token_label(token),
+			(unsigned long)token_line(token), symbols[token->symbol], tok_len,
+			token_from(token));
 	}
 	return p;
 }
@@ -583,8 +818,8 @@ static int is_static(const struct TokenArray *const code) {
 		&& tokens[0].symbol == ID && tokens[0].length == 3
 		&& tokens[1].symbol == ID && tokens[1].length == 4
 		&& tokens[2].symbol == LPAREN
-		&& !strncmp(tokens[0].from, "int", 3)
-		&& !strncmp(tokens[1].from, "main", 4));
+		&& !strncmp(token_from(tokens + 0), "int", 3)
+		&& !strncmp(token_from(tokens + 1), "main", 4));
 }
 
 /** @implements{Predicate<Segment>} */
@@ -607,16 +842,20 @@ static int keep_segment(const struct Segment *const s) {
 	if(!keep && CdocGetDebug() & DBG_ERASE) {
 		char a[12];
 		segment_to_string(s, &a);
-		fprintf(stderr, "keep_segment: erasing %s.\n", a);
+		fprintf(CdocGetErr(), "keep_segment: erasing %s.\n", a);
 	}
 	return keep;
 }
 
-/** Keeps only the stuff we care about; discards no docs except fn and `static`
- if not `@allow`. */
-void ReportCull(void) {
-	SegmentArrayKeepIf(&report, &keep_segment, &erase_segment);
+/** Keeps only the stuff we care about in `r`; discards no docs except fn and
+ `static` if not `@allow`. */
+void ReportCull(struct Report *const r) {
+	assert(r);
+	report_use(r);
+	SegmentArrayKeepIf(&r->segments, &keep_segment, &erase_segment);
+	index_invalidate(r);
 }
 
+#include "ReportCache.h"
 #include "ReportOut.h"
 #include "ReportWarning.h"
@@ -10,15 +10,31 @@ size_t TokensMarkSize(const struct TokenArray *const tokens);
 void TokensMark(const struct TokenArray *const tokens, char *const marks);
 
 struct Token;
+struct Text;
 
 int ReportCurrentDivision(const enum Division division);
 int ReportCurrentParam(const struct Token *const token);
 void ReportCurrentReset(void);
 
-void Report_(void);
+/* A report is not a render context; the state of scanning and output is
+ `THREAD_LOCAL`: the report and arena that the functions taking a report bind,
+ and the style, buffers, sink, and URL encoding that they use. Every thread can
+ work on it's own report at the same time, but one thread can't interleave
+ two, and a report can't move threads in the middle of <fn:ReportScan> or
+ <fn:ReportOut>. Without `THREAD_LOCAL_SEPARATE`, there is only one thread. */
+struct Report;
+
+void Report_(struct Report **const pr);
+struct Report *Report(const char *const in_fn, const char *const out_fn);
+int ReportClear(struct Report *const r, const char *const in_fn,
+	const char *const out_fn);
 void ReportDivision(const enum Division division);
-void ReportLastSegmentDebug(void);
-int ReportNotify(const struct Scanner *const scan);
-void ReportCull(void);
-void ReportWarn(void);
-int ReportOut(void);
+void ReportLastSegmentDebug(struct Report *const r);
+int ReportScan(struct Report *const r, struct Text *const text);
+void ReportCull(struct Report *const r);
+int ReportCacheSave(struct Report *const r, const char *const dir,
+	const char *const said, const size_t said_size);
+int ReportCacheLoad(struct Report *const r, const char *const dir,
+	int *const is_loaded, const char **const said, size_t *const said_size);
+void ReportWarn(struct Report *const r);
+int ReportOut(struct Report *const r, const enum Format format);
@@ -0,0 +1,305 @@
+/* The parse cache of a report, after <fn:ReportCull>, (see `Cache.h`.) It's
+ the files that were read, with their size and hash, the sources as the index
+ of a file, the segments with their tokens, parameters, and attributes, and
+ the diagnostics of parsing, which can't be made again from the segments.
+ Tokens are their offset, length, symbol, and source, so nothing points;
+ they are checked against the sizes of the files when they're read, so a
+ damaged cache is a miss. All of the numbers are 32-bit little-endian. */
+
+#define ARRAY_NAME Byte
+#define ARRAY_TYPE unsigned char
+#include "Array.h"
+
+/** Appends `x` to `bytes`. @return Success. @throws[realloc] */
+static int cache_put(struct ByteArray *const bytes, const unsigned long x) {
+	unsigned char *const b = ByteArrayBuffer(bytes, 4);
+	if(!b) return 0;
+	b[0] = (unsigned char)(x & 0xff), b[1] = (unsigned char)(x >> 8 & 0xff);
+	b[2] = (unsigned char)(x >> 16 & 0xff);
+	b[3] = (unsigned char)(x >> 24 & 0xff);
+	return 1;
+}
+
+/** Appends `t` to `bytes`. @return Success. @throws[realloc] */
+static int cache_put_token(struct ByteArray *const bytes,
+	const struct Token *const t) {
+	return cache_put(bytes, t->offset)
+		&& cache_put(bytes, (unsigned long)t->length)
+		&& cache_put(bytes, t->symbol)
+		&& cache_put(bytes, t->file);
+}
+
+/** Appends the size of `tokens` to `bytes`. @return Success.
+ @throws[realloc] */
+static int cache_put_size(struct ByteArray *const bytes,
+	const struct TokenArray *const tokens) {
+	return cache_put(bytes, (unsigned long)TokenArraySize(tokens));
+}
+
+/** Appends `tokens` to `bytes`. @return Success. @throws[realloc] */
+static int cache_put_tokens(struct ByteArray *const bytes,
+	const struct TokenArray *const tokens) {
+	const struct Token *t = 0;
+	while((t = TokenArrayNext(tokens, t)))
+		if(!cache_put_token(bytes, t)) return 0;
+	return 1;
+}
+
+/** @return The index of the file in `Depend.h` that has `buffer`, or
+ <fn:DependSize> if there is none. */
+static size_t cache_file(const char *const buffer) {
+	size_t i;
+	for(i = 0; i < DependSize(); i++)
+		if(TextGet(TextFind(DependGet(i))) == buffer) break;
+	return i;
+}
+
+/** Stores `r`, which has been culled, in the cache in `dir`; the files in
+ `Depend.h` must be the ones that it read.
+ @param[said, said_size] What was printed while parsing `r`.
+ @return Success. @throws[realloc, mkdir, fopen, fwrite, rename] */
+int ReportCacheSave(struct Report *const r, const char *const dir,
+	const char *const said, const size_t said_size) {
+	struct ByteArray bytes;
+	const struct Source *source = 0;
+	const struct Segment *segment = 0;
+	const struct Attribute *att;
+	const size_t *param;
+	size_t i;
+	unsigned char *b;
+	int success = 0;
+	assert(r && dir && (said || !said_size));
+	report_use(r);
+	ByteArray(&bytes);
+	if(!cache_put(&bytes, (unsigned long)DependSize())) goto finally;
+	for(i = 0; i < DependSize(); i++) {
+		const char *const fn = DependGet(i);
+		const size_t fn_size = strlen(fn) + 1;
+		const struct Text *const text = TextFind(fn);
+		if(!text || !cache_put(&bytes, (unsigned long)TextSize(text))
+			|| !cache_put(&bytes, CacheHash(TextGet(text), TextSize(text)))
+			|| !cache_put(&bytes, (unsigned long)fn_size)
+			|| !(b = ByteArrayBuffer(&bytes, fn_size))) goto finally;
+		memcpy(b, fn, fn_size);
+	}
+	if(!cache_put(&bytes, (unsigned long)SourceArraySize(&r->sources)))
+		goto finally;
+	while((source = SourceArrayNext(&r->sources, source))) {
+		/* They always are; if not, it's not cached. */
+		if((i = cache_file(source->buffer)) == DependSize())
+			{ success = 1; goto finally; }
+		if(!cache_put(&bytes, (unsigned long)i)) goto finally;
+	}
+	if(!cache_put(&bytes, (unsigned long)SegmentArraySize(&r->segments)))
+		goto finally;
+	while((segment = SegmentArrayNext(&r->segments, segment))) {
+		if(!cache_put(&bytes, (unsigned long)segment->division)
+			|| !cache_put_size(&bytes, &segment->doc)
+			|| !cache_put_size(&bytes, &segment->code)
+			|| !cache_put(&bytes,
+			(unsigned long)IndexArraySize(&segment->code_params))
+			|| !cache_put(&bytes,
+			(unsigned long)AttributeArraySize(&segment->attributes))
+			|| !cache_put_tokens(&bytes, &segment->doc)
+			|| !cache_put_tokens(&bytes, &segment->code)) goto finally;
+		for(param = 0; (param = IndexArrayNext(&segment->code_params, param)); )
+			if(!cache_put(&bytes, (unsigned long)*param)) goto finally;
+		for(att = 0; (att = AttributeArrayNext(&segment->attributes, att)); )
+			if(!cache_put_token(&bytes, &att->token)
+			|| !cache_put_size(&bytes, &att->header)
+			|| !cache_put_size(&bytes, &att->contents)
+			|| !cache_put_tokens(&bytes, &att->header)
+			|| !cache_put_tokens(&bytes, &att->contents)) goto finally;
+	}
+	/* It's not worth keeping. */
+	if(said_size > 0xffffffffUL) { success = 1; goto finally; }
+	if(!cache_put(&bytes, (unsigned long)said_size)
+		|| (said_size && !(b = ByteArrayBuffer(&bytes, said_size))))
+		goto finally;
+	if(said_size) memcpy(b, said, said_size);
+	success = CacheStore(dir, r->in_fn, (unsigned)CdocGetDocOnly(),
+		ByteArrayGet(&bytes), ByteArraySize(&bytes));
+finally:
+	ByteArray_(&bytes);
+	return success;
+}
+
+/* Reading the cache: `b` is the next number, up to `end`. */
+struct CacheRead { const unsigned char *b, *end; };
+
+/** Reads the next number in `c` into `x`. @return Whether there was one. */
+static int cache_get(struct CacheRead *const c, unsigned long *const x) {
+	if(c->end - c->b < 4) return 0;
+	*x = (unsigned long)c->b[0] | (unsigned long)c->b[1] << 8
+		| (unsigned long)c->b[2] << 16 | (unsigned long)c->b[3] << 24;
+	c->b += 4;
+	return 1;
+}
+
+/** Reads the name of a file in `c` into `fn`.
+ @return Whether it was there and null-terminated. */
+static int cache_get_name(struct CacheRead *const c, const char **const fn) {
+	unsigned long size;
+	if(!cache_get(c, &size) || !size || (unsigned long)(c->end - c->b) < size
+		|| c->b[size - 1] != '\0') return 0;
+	*fn = (const char *)c->b, c->b += size;
+	return 1;
+}
+
+/** Reads a token in `c` into `t`.
+ @param[sizes] The sizes of the sources, with the null.
+ @return Whether it's there and in it's source. */
+static int cache_get_token(struct CacheRead *const c, struct Token *const t,
+	const struct IndexArray *const sizes) {
+	unsigned long offset, length, symbol, file;
+	size_t size;
+	if(!cache_get(c, &offset) || !cache_get(c, &length)
+		|| !cache_get(c, &symbol) || !cache_get(c, &file)
+		|| file >= IndexArraySize(sizes) || length > INT_MAX
+		|| symbol >= sizeof symbols / sizeof *symbols) return 0;
+	size = IndexArrayGet(sizes)[file];
+	if(offset >= size || length >= size - offset) return 0;
+	t->offset = (unsigned)offset, t->length = (int)length;
+	t->symbol = (unsigned)symbol;
+	t->file = (unsigned)file;
+	return 1;
+}
+
+/** Reads `no` tokens in `c` into `tokens`.
+ @return Whether they were there; if false and `errno` is set, there was an
+ error. @throws[realloc] */
+static int cache_get_tokens(struct CacheRead *const c,
+	struct TokenArray *const tokens, const unsigned long no,
+	const struct IndexArray *const sizes) {
+	struct Token *t, *end;
+	if(!no) return 1;
+	if((unsigned long)(c->end - c->b) / 16 < no
+		|| !(t = TokenArrayBuffer(tokens, (size_t)no))) return 0;
+	for(end = t + no; t < end; t++)
+		if(!cache_get_token(c, t, sizes)) return 0;
+	return 1;
+}
+
+/** Loads the files and the sources in `c` into `r` and `sizes`.
+ @return Whether they are there and the same now; if false and `errno` is
+ set, there was an error. @throws[realloc] */
+static int cache_get_sources(struct CacheRead *const c,
+	struct Report *const r, struct IndexArray *const sizes) {
+	unsigned long files_no, no, size, hash, i, f;
+	struct Source *source;
+	const char *fn;
+	const struct Text *text;
+	size_t *s;
+	if(!cache_get(c, &files_no)) return 0;
+	for(i = 0; i < files_no; i++) {
+		if(!cache_get(c, &size) || !cache_get(c, &hash)
+			|| !cache_get_name(c, &fn)) return 0;
+		/* It may not be there any more; that's not our problem. The input is
+		 in use already; it's not kept open like the headers. */
+		if(!(text = strcmp(fn, r->in_fn) ? TextOpen(fn) : TextFind(fn)))
+			return errno = 0, 0;
+		if(TextSize(text) != size
+			|| CacheHash(TextGet(text), TextSize(text)) != hash) return 0;
+		if(!(source = SourceArrayNew(&r->sources))
+			|| !(s = IndexArrayNew(sizes))) return 0;
+		source->label = TextBaseName(text), source->buffer = TextGet(text);
+		source->text = text;
+		*s = TextSize(text);
+	}
+	/* The files are the first `files_no`; the sources come after. */
+	if(!cache_get(c, &no)) return 0;
+	for(i = 0; i < no; i++) {
+		if(!cache_get(c, &f) || f >= files_no
+			|| !(source = SourceArrayNew(&r->sources))
+			|| !(s = IndexArrayNew(sizes))) return 0;
+		*source = SourceArrayGet(&r->sources)[f];
+		*s = IndexArrayGet(sizes)[f];
+	}
+	return SourceArrayIndexSplice(&r->sources, 0, (size_t)files_no, 0)
+		&& IndexArrayIndexSplice(sizes, 0, (size_t)files_no, 0);
+}
+
+/** Loads the segments in `c` into `r`.
+ @return Whether they are there; if false and `errno` is set, there was an
+ error. @throws[realloc] */
+static int cache_get_segments(struct CacheRead *const c,
+	struct Report *const r, const struct IndexArray *const sizes) {
+	unsigned long no, division, doc_no, code_no, params_no, atts_no, i, j, x;
+	struct Segment *segment;
+	struct Attribute *att;
+	size_t *param;
+	if(!cache_get(c, &no)) return 0;
+	for(i = 0; i < no; i++) {
+		if(!cache_get(c, &division) || !cache_get(c, &doc_no)
+			|| !cache_get(c, &code_no) || !cache_get(c, &params_no)
+			|| !cache_get(c, &atts_no)
+			|| division >= sizeof divisions / sizeof *divisions
+			|| !(segment = new_segment(r))) return 0;
+		segment->division = (enum Division)division;
+		if(!cache_get_tokens(c, &segment->doc, doc_no, sizes)
+			|| !cache_get_tokens(c, &segment->code, code_no, sizes))
+			return 0;
+		for(j = 0; j < params_no; j++) {
+			if(!cache_get(c, &x) || x >= code_no
+				|| !(param = IndexArrayNew(&segment->code_params))) return 0;
+			*param = (size_t)x;
+		}
+		for(j = 0; j < atts_no; j++) {
+			unsigned long header_no, contents_no;
+			if(!(att = AttributeArrayNew(&segment->attributes))) return 0;
+			TokenArray(&att->header), TokenArray(&att->contents);
+			if(!cache_get_token(c, &att->token, sizes)
+				|| !cache_get(c, &header_no) || !cache_get(c, &contents_no)
+				|| !cache_get_tokens(c, &att->header, header_no, sizes)
+				|| !cache_get_tokens(c, &att->contents, contents_no, sizes))
+				return 0;
+		}
+	}
+	return 1;
+}
+
+/** Loads `r`, which is empty, from the cache in `dir`, if all the files that
+ it read are the same now; they are added to `Depend.h`. Then `r` is as
+ <fn:ReportScan> and <fn:ReportCull> left it.
+ @param[is_loaded] Set if it was loaded; otherwise `r` is still empty.
+ @param[said, said_size] Set to what was printed while parsing `r`, to say
+ again, if it was loaded. It's valid until the next <fn:CacheLoad>.
+ @return Success. @throws[realloc, open, fopen, fread] */
+int ReportCacheLoad(struct Report *const r, const char *const dir,
+	int *const is_loaded, const char **const said, size_t *const said_size) {
+	struct CacheRead c, files;
+	struct IndexArray sizes;
+	unsigned long files_no, size, hash, i, said_no;
+	const char *fn;
+	size_t data_size;
+	assert(r && dir && is_loaded && said && said_size
+		&& !SourceArraySize(&r->sources)
+		&& !SegmentArraySize(&r->segments));
+	report_use(r);
+	*is_loaded = 0, *said = 0, *said_size = 0;
+	errno = 0;
+	if(!(c.b = CacheLoad(dir, r->in_fn, (unsigned)CdocGetDocOnly(),
+		&data_size))) return !errno;
+	c.end = c.b + data_size, files = c;
+	IndexArray(&sizes);
+	if(cache_get_sources(&c, r, &sizes) && cache_get_segments(&c, r, &sizes)
+		&& cache_get(&c, &said_no)
+		&& (unsigned long)(c.end - c.b) == said_no) {
+		*said = (const char *)c.b, *said_size = (size_t)said_no;
+		/* Checked already. */
+		cache_get(&files, &files_no);
+		for(i = 0; i < files_no; i++) {
+			cache_get(&files, &size), cache_get(&files, &hash);
+			if(!cache_get_name(&files, &fn) || !DependAdd(fn)) break;
+		}
+		if(i == files_no) *is_loaded = 1;
+	}
+	IndexArray_(&sizes);
+	if(*is_loaded) return 1;
+	*said = 0, *said_size = 0;
+	SegmentArrayClear(&r->segments);
+	SourceArrayClear(&r->sources);
+	index_invalidate(r);
+	ArenaClear(r->arena);
+	return !errno;
+}
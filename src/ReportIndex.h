@@ -0,0 +1,174 @@
+/* Every titled segment in a report memoises its label, and an index from the
+ division and raw label to the segment, so that links can be resolved
+ without re-printing the labels of the whole division for every link. The
+ index is invalidated whenever the segments change and rebuilt on demand.
+ Other than the destructor and the invalidation, these work on the bound
+ `report`. */
+
+/** Perform a 32 bit
+ [Fowler/Noll/Vo FNV-1a hash](http://www.isthe.com/chongo/tech/comp/fnv/) on a
+ string. This assumes that size of `int` is at least 32 bits; if this is not
+ true, we may get a different answer, (`stdint.h` is `C99`.) */
+static unsigned fnv_32a_str(const char *str) {
+	const unsigned char *s = (const unsigned char *)str;
+	/* 32 bit FNV-1 and FNV-1a non-zero initial basis, FNV1_32A_INIT */
+	unsigned hval = 0x811c9dc5;
+	assert(str);
+	/* FNV magic prime `FNV_32_PRIME 0x01000193`. */
+	while(*s) {
+		hval ^= *s++;
+		hval += (hval<<1) + (hval<<4) + (hval<<7) + (hval<<8) + (hval<<24);
+	}
+	if(CdocGetDebug() & DBG_HASH)
+		fprintf(CdocGetErr(), "fnv32: %s -> %u\n", str, hval);
+	return hval & 0xffffffff;
+}
+
+/** Call when the segments of `r` change. */
+static void index_invalidate(struct Report *const r) { r->index.is_valid = 0; }
+
+/** Empties the index and the labels of `r`, for different segments. */
+static void index_clear(struct Report *const r) {
+	LabelArrayClear(&r->index.labels);
+	BucketArrayClear(&r->index.buckets);
+	r->index.is_valid = 0;
+}
+
+/** Destructor for the index and the labels of `r`. */
+static void index_(struct Report *const r) {
+	LabelArray_(&r->index.labels);
+	BucketArray_(&r->index.buckets);
+	r->index.is_valid = 0;
+}
+
+/** Appends `length` of `from` and a null to the label pool.
+ @return The offset or `(size_t)-1` on error. @throws[realloc] */
+static size_t label_pool(const char *const from, const size_t length) {
+	const size_t offset = LabelArraySize(&report->index.labels);
+	char *copy;
+	if(!(copy = LabelArrayBuffer(&report->index.labels, length + 1)))
+		return (size_t)-1;
+	memcpy(copy, from, length), copy[length] = '\0';
+	return offset;
+}
+
+/** Memoises the title of `segment` the first time, including the expansion
+ of generics. The raw label is also used for Markdown fragments; the
+ HTML-escaped label is the text of the anchor.
+ @return Whether `segment` has a title; if so, it's `is_labelled`.
+ @throws[realloc] Returns false, and `errno` is set. */
+static int segment_label(struct Segment *const segment) {
+	const size_t *title;
+	const char *b;
+	size_t length;
+	if(segment->is_labelled) return 1;
+	/* The "title" is `code[code_params[0]]`. */
+	if(segment->division == DIV_PREAMBLE
+		|| !(title = IndexArrayNext(&segment->code_params, 0))
+		|| *title >= TokenArraySize(&segment->code)) return 0;
+	StylePush(ST_TO_RAW); /* Anchors are always raw. */
+	b = print_token_s(&segment->code, TokenArrayGet(&segment->code) + *title);
+	StylePop();
+	length = strlen(b);
+	if((segment->label = label_pool(b, length)) == (size_t)-1) return 0;
+	segment->hash = fnv_32a_str(b);
+	/* `b` is gone by now; use the copy. */
+	BufferClear();
+	StylePush(ST_TO_HTML);
+	b = StyleEncodeLengthCatToBuffer((int)length,
+		LabelArrayGet(&report->index.labels) + segment->label);
+	StylePop();
+	if((segment->html_label = label_pool(b, strlen(b))) == (size_t)-1)
+		return 0;
+	return segment->is_labelled = 1;
+}
+
+/** @return The raw title of `segment`, which must be labelled. */
+static const char *label_raw(const struct Segment *const segment) {
+	assert(segment && segment->is_labelled);
+	return LabelArrayGet(&report->index.labels) + segment->label;
+}
+
+/** @return The title of `segment` in HTML, which must be labelled. */
+static const char *label_html(const struct Segment *const segment) {
+	assert(segment && segment->is_labelled);
+	return LabelArrayGet(&report->index.labels) + segment->html_label;
+}
+
+/** @return The first bucket for `division` and `hash` under `mask`. */
+static size_t index_bucket(const enum Division division, const unsigned hash,
+	const size_t mask) { return ((size_t)hash + (size_t)division) & mask; }
+
+/** Labels all segments in `report` and rebuilds the index if they have
+ changed.
+ @return Success. @throws[realloc] */
+static int index_update(void) {
+	struct Segment *segment = 0;
+	size_t *buckets, capacity = 8, mask, size = 0;
+	if(report->index.is_valid) return 1;
+	while((segment = SegmentArrayNext(&report->segments, segment))) {
+		errno = 0;
+		if(segment_label(segment)) size++;
+		else if(errno) return 0;
+	}
+	/* Keep the load factor at or below a half. */
+	while(capacity < size << 1) capacity <<= 1;
+	mask = capacity - 1;
+	BucketArrayClear(&report->index.buckets);
+	if(!(buckets = BucketArrayBuffer(&report->index.buckets, capacity)))
+		return 0;
+	memset(buckets, 0, sizeof *buckets * capacity);
+	while((segment = SegmentArrayNext(&report->segments, segment))) {
+		size_t b;
+		if(!segment->is_labelled) continue;
+		for(b = index_bucket(segment->division, segment->hash, mask);
+			buckets[b]; b = (b + 1) & mask);
+		buckets[b] = SegmentArrayIndex(&report->segments, segment) + 1;
+	}
+	report->index.is_valid = 1;
+	return 1;
+}
+
+/** Adds the labelled segments of `report`, which is in `format`, to the
+ catalog for other outputs, instead of what it had before. Must have called
+ <fn:index_update> since `report` last changed.
+ @return Success. @throws[realloc] */
+static int index_catalog(const enum Format format) {
+	const struct Segment *segment = 0;
+	struct CatalogSymbol symbol;
+	if(!report->out_fn) return 1;
+	if(!CatalogOutput(report->out_fn)) return 0;
+	symbol.output = report->out_fn, symbol.is_html = format == OUT_HTML;
+	while((segment = SegmentArrayNext(&report->segments, segment))) {
+		const struct Token *title;
+		if(!segment->is_labelled) continue;
+		title = TokenArrayGet(&segment->code)
+			+ IndexArrayGet(&segment->code_params)[0];
+		symbol.label = label_raw(segment);
+		symbol.source = token_label(title), symbol.line = token_line(title);
+		symbol.division = segment->division, symbol.hash = segment->hash;
+		if(!CatalogAdd(&symbol)) return 0;
+	}
+	return 1;
+}
+
+/** Must have called <fn:index_update> since `report` last changed.
+ @param[label] Raw label.
+ @return The first segment in `division` with `label`, or null if there is
+ none. */
+static const struct Segment *index_find(const enum Division division,
+	const char *const label) {
+	const size_t *const buckets = BucketArrayGet(&report->index.buckets),
+		mask = BucketArraySize(&report->index.buckets) - 1;
+	const struct Segment *const segments = SegmentArrayGet(&report->segments);
+	const unsigned hash = fnv_32a_str(label);
+	size_t b;
+	assert(report->index.is_valid && buckets && label);
+	for(b = index_bucket(division, hash, mask); buckets[b];
+		b = (b + 1) & mask) {
+		const struct Segment *const segment = segments + buckets[b] - 1;
+		if(segment->division == division && segment->hash == hash
+			&& !strcmp(label_raw(segment), label)) return segment;
+	}
+	return 0;
+}
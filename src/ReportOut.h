@@ -1,22 +1,3 @@
-/** Perform a 32 bit
- [Fowler/Noll/Vo FNV-1a hash](http://www.isthe.com/chongo/tech/comp/fnv/) on a
- string. This assumes that size of `int` is at least 32 bits; if this is not
- true, we may get a different answer, (`stdint.h` is `C99`.) */
-static unsigned fnv_32a_str(const char *str) {
-	const unsigned char *s = (const unsigned char *)str;
-	/* 32 bit FNV-1 and FNV-1a non-zero initial basis, FNV1_32A_INIT */
-	unsigned hval = 0x811c9dc5;
-	assert(str);
-	/* FNV magic prime `FNV_32_PRIME 0x01000193`. */
-	while(*s) {
-		hval ^= *s++;
-		hval += (hval<<1) + (hval<<4) + (hval<<7) + (hval<<8) + (hval<<24);
-	}
-	if(CdocGetDebug() & DBG_HASH)
-		fprintf(stderr, "fnv32: %s -> %u\n", str, hval);
-	return hval & 0xffffffff;
-}
-
 /* This is very `GitHub`-2019 specific: all anchor names are pre-concatenated
  with this string _except_ those that already have it, but the fragment
  links are unchanged. To make them line up and also be a valid Markdown for
@@ -61,12 +42,12 @@ OUT(par) {
 }
 OUT(lit) {
 	const struct Token *const t = *ptoken;
-	assert(tokens && t && t->length > 0 && t->from);
+	assert(tokens && t && t->length > 0 && token_from(t));
 	if(is_buffer) {
-		StyleEncodeLengthCatToBuffer(t->length, t->from);
+		StyleEncodeLengthCatToBuffer(t->length, token_from(t));
 	} else {
 		StyleFlushSymbol(t->symbol);
-		StyleEncodeLength(t->length, t->from);
+		StyleEncodeSource(t->length, token_from(t));
 	}
 	*ptoken = TokenArrayNext(tokens, t);
 	return 1;
@@ -84,24 +65,26 @@ OUT(gen1) {
 	assert(tokens && t && t->symbol == ID_ONE_GENERIC);
 	if(!lparen || lparen->symbol != LPAREN || !param1 || !rparen
 		|| rparen->symbol != RPAREN) goto catch;
-	type1 = t->from;
+	type1 = token_from(t);
 	if(!(b = strchr(type1, '_'))) goto catch;
 	type1_size = (int)(b - type1);
-	assert(t->length == b + 1 - t->from);
+	assert(t->length == b + 1 - token_from(t));
 	if(is_buffer) {
 		const char *const ltgt = f == OUT_HTML ? HTML_LT HTML_GT : "<>";
 		char *a;
 		if(!(a = BufferPrepare(strlen(ltgt)
 			+ type1_size + param1->length))) return 0;		
-		sprintf(a, format, type1_size, type1, param1->length, param1->from);
+		sprintf(a, format, type1_size, type1,
+			param1->length, token_from(param1));
 	} else {
 		StyleFlushSymbol(t->symbol);
-		printf(format, type1_size, type1, param1->length, param1->from);
+		SinkPrintf(format, type1_size, type1,
+			param1->length, token_from(param1));
 	}
 	*ptoken = TokenArrayNext(tokens, rparen);
 	return 1;
 catch:
-	fprintf(stderr, "%s: expected generic(id) %s.\n", pos(t),
+	fprintf(CdocGetErr(), "%s: expected generic(id) %s.\n", pos(t),
 		TokenArrayToString(tokens));
 	return 0;
 }
@@ -121,29 +104,31 @@ OUT(gen2) {
 	if(!lparen || lparen->symbol != LPAREN || !param1 || !comma
 		|| comma->symbol != COMMA || !param2 || !rparen
 		|| rparen->symbol != RPAREN) goto catch;
-	type1 = t->from;
+	type1 = token_from(t);
 	if(!(b = strchr(type1, '_'))) goto catch;
 	type1_size = (int)(b - type1);
 	type2 = b + 1;
 	if(!(b = strchr(type2, '_'))) goto catch;
 	type2_size = (int)(b - type2);
-	assert(t->length == b + 1 - t->from);
+	assert(t->length == b + 1 - token_from(t));
 	if(is_buffer) {
 		const char *const ltgt = f == OUT_HTML ? HTML_LT HTML_GT : "<>";
 		char *a;
 		if(!(a = BufferPrepare(2 * strlen(ltgt) + type1_size + param1->length
 			+ type2_size + param2->length))) return 0;
-		sprintf(a, format, type1_size, type1, param1->length, param1->from,
-			type2_size, type2, param2->length, param2->from);
+		sprintf(a, format, type1_size, type1,
+			param1->length, token_from(param1), type2_size, type2,
+			param2->length, token_from(param2));
 	} else {
 		StyleFlushSymbol(t->symbol);
-		printf(format, type1_size, type1, param1->length, param1->from,
-			type2_size, type2, param2->length, param2->from);
+		SinkPrintf(format, type1_size, type1,
+			param1->length, token_from(param1), type2_size, type2,
+			param2->length, token_from(param2));
 	}
 	*ptoken = TokenArrayNext(tokens, rparen);
 	return 1;
 catch:
-	fprintf(stderr, "%s: expected generic2(id,id).\n", pos(t));
+	fprintf(CdocGetErr(), "%s: expected generic2(id,id).\n", pos(t));
 	return 0;
 }
 OUT(gen3) {
@@ -166,7 +151,7 @@ OUT(gen3) {
 		|| comma1->symbol != COMMA || !param2 || !comma2 ||
 		comma2->symbol != COMMA || !param3 || !rparen
 		|| rparen->symbol != RPAREN) goto catch;
-	type1 = t->from;
+	type1 = token_from(t);
 	if(!(b = strchr(type1, '_'))) goto catch;
 	type1_size = (int)(b - type1);
 	type2 = b + 1;
@@ -175,33 +160,35 @@ OUT(gen3) {
 	type3 = b + 1;
 	if(!(b = strchr(type3, '_'))) goto catch;
 	type3_size = (int)(b - type3);
-	assert(t->length == b + 1 - t->from);
+	assert(t->length == b + 1 - token_from(t));
 	if(is_buffer) {
 		const char *const ltgt = f == OUT_HTML ? HTML_LT HTML_GT : "<>";
 		char *a;
 		if(!(a = BufferPrepare(3 * strlen(ltgt) + type1_size + param1->length
 			+ type2_size + param2->length
 			+ type3_size + param3->length))) return 0;
-		sprintf(a, format, type1_size, type1, param1->length, param1->from,
-			type2_size, type2, param2->length, param2->from, type3_size, type3,
-			param3->length, param3->from);
+		sprintf(a, format, type1_size, type1,
+			param1->length, token_from(param1), type2_size, type2,
+			param2->length, token_from(param2), type3_size, type3,
+			param3->length, token_from(param3));
 	} else {
 		StyleFlushSymbol(t->symbol);
-		printf(format, type1_size, type1, param1->length, param1->from,
-			type2_size, type2, param2->length, param2->from, type3_size, type3,
-			param3->length, param3->from);
+		SinkPrintf(format, type1_size, type1,
+			param1->length, token_from(param1), type2_size, type2,
+			param2->length, token_from(param2), type3_size, type3,
+			param3->length, token_from(param3));
 	}
 	*ptoken = TokenArrayNext(tokens, rparen);
 	return 1;
 catch:
-	fprintf(stderr, "%s: expected A_B_C_(id,id,id).\n", pos(t));
+	fprintf(CdocGetErr(), "%s: expected A_B_C_(id,id,id).\n", pos(t));
 	return 0;
 }
 OUT(escape) {
 	const struct Token *const t = *ptoken;
 	assert(tokens && t && t->symbol == ESCAPE && t->length == 2 && !is_buffer);
 	StyleFlushSymbol(t->symbol);
-	StyleEncodeLength(1, t->from + 1);
+	StyleEncodeLength(1, token_from(t) + 1);
 	*ptoken = TokenArrayNext(tokens, t);
 	return 1;
 }
@@ -211,62 +198,107 @@ OUT(url) {
 	StyleFlushSymbol(t->symbol);
 	/* I think it can't contain '<>()\"' by the parser. */
 	if(StyleFormat() == OUT_HTML) {
-		printf("<a href = \"%.*s\">", t->length, t->from);
-		StyleEncodeLength(t->length, t->from);
-		printf("</a>");
+		SinkPrintf("<a href = \"%.*s\">", t->length, token_from(t));
+		StyleEncodeSource(t->length, token_from(t));
+		SinkPuts("</a>");
 	} else {
-		printf("[");
-		StyleEncodeLength(t->length, t->from);
-		printf("](%.*s)", t->length, t->from);
+		SinkPuts("[");
+		StyleEncodeSource(t->length, token_from(t));
+		SinkPrintf("](%.*s)", t->length, token_from(t));
 	}
 	*ptoken = TokenArrayNext(tokens, t);
 	return 1;
 }
 OUT(cite) {
 	const struct Token *const t = *ptoken;
-	const char *const url_encoded = UrlEncode(t->from, t->length);
+	const char *const url_encoded = UrlEncode(token_from(t), t->length);
 	assert(tokens && t && t->symbol == CITE && !is_buffer);
 	if(!url_encoded) goto catch;
 	StyleFlushSymbol(t->symbol);
 	if(StyleFormat() == OUT_HTML) {
-		printf("<a href = \"https://scholar.google.ca/scholar?q=%s\">",
+		SinkPrintf("<a href = \"https://scholar.google.ca/scholar?q=%s\">",
 			url_encoded);
-		StyleEncodeLength(t->length, t->from);
-		printf("</a>");
+		StyleEncodeSource(t->length, token_from(t));
+		SinkPuts("</a>");
 	} else {
-		printf("[");
-		StyleEncodeLength(t->length, t->from);
-		printf("](https://scholar.google.ca/scholar?q=%s)", url_encoded);
+		SinkPuts("[");
+		StyleEncodeSource(t->length, token_from(t));
+		SinkPrintf("](https://scholar.google.ca/scholar?q=%s)", url_encoded);
 	}
 	*ptoken = TokenArrayNext(tokens, t);
 	return 1;
 catch:
-	fprintf(stderr, "%s: expected <source>.\n", pos(t));
+	fprintf(CdocGetErr(), "%s: expected <source>.\n", pos(t));
 	return 0;
 }
+/** If `raw`, with `hash`, is not in `divn` of this report, but it's in
+ another output in the catalog, sets `other_fn` to the path to that and fills
+ `other`; otherwise it's null. The output depends on the catalog if it was
+ looked in. @return Success. @throws[realloc] */
+static int see_other(const enum Division divn, const char *const raw,
+	const unsigned hash, struct CatalogSymbol *const other,
+	const char **const other_fn) {
+	const char *const catalog_fn = CatalogName();
+	*other_fn = 0;
+	if(!report->out_fn || !catalog_fn) return 1;
+	if(!DependAdd(catalog_fn)) return 0;
+	if(CatalogFind(divn, raw, hash, other)
+		&& strcmp(other->output, report->out_fn))
+		*other_fn = PathToOutput(report->path, other->output);
+	return 1;
+}
+
 static int see(const struct TokenArray *const tokens,
 	const struct Token **ptoken, const int is_buffer,
 	const enum Division divn) {
 	const struct Token *const tok = *ptoken;
+	const struct Segment *target;
+	const char *raw, *other_fn = 0;
+	unsigned hash;
+	struct CatalogSymbol other;
 	assert(tokens && tok && !is_buffer
 		&& ((tok->symbol == SEE_FN && divn == DIV_FUNCTION)
 		|| (tok->symbol == SEE_TAG && divn == DIV_TAG)
 		|| (tok->symbol == SEE_TYPEDEF && divn == DIV_TYPEDEF)
 		|| (tok->symbol == SEE_DATA && divn == DIV_DATA)));
 	StyleFlushSymbol(tok->symbol);
+	/* It's looked up once; if it's not here, it may be in another output,
+	 where the anchor is in the format of that. A broken link is warned about
+	 already, and goes to where it would be. */
+	raw = StyleEncodeLengthRawToBuffer(tok->length, token_from(tok));
+	hash = (target = index_find(divn, raw)) ? target->hash : fnv_32a_str(raw);
+	if(!target && !see_other(divn, raw, hash, &other, &other_fn)) return 0;
 	if(StyleFormat() == OUT_HTML) {
-		printf("<a href = \"#%s:", division_strings[divn]);
-		StyleEncodeLength(tok->length, tok->from);
-		printf("\">");
-		StyleEncodeLength(tok->length, tok->from);
-		printf("</a>");
+		SinkPuts("<a href = \"");
+		if(other_fn && !other.is_html) {
+			SinkPrintf("%s#%s%s-%lx\">", other_fn, md_fragment_extra,
+				division_strings[divn], other.hash);
+		} else {
+			if(other_fn) SinkPuts(other_fn);
+			SinkPrintf("#%s:", division_strings[divn]);
+			StyleEncodeSource(tok->length, token_from(tok));
+			SinkPuts("\">");
+		}
+		StyleEncodeSource(tok->length, token_from(tok));
+		SinkPuts("</a>");
+	} else if(other_fn) {
+		const char *const encoded = other.is_html
+			? UrlEncode(other.label, strlen(other.label)) : "";
+		SinkPuts("[");
+		StylePush(ST_TO_HTML); /* <-- html: this is not escaped by Markdown. */
+		StyleEncodeSource(tok->length, token_from(tok));
+		StylePop(); /* html --> */
+		if(other.is_html) SinkPrintf("](%s#%s:%s)", other_fn,
+			division_strings[divn], encoded ? encoded : "");
+		else SinkPrintf("](%s#%s%s-%lx)", other_fn, md_fragment_extra,
+			division_strings[divn], other.hash);
 	} else {
-		printf("[");
+		SinkPuts("[");
 		StylePush(ST_TO_HTML); /* <-- html: this is not escaped by Markdown. */
-		StyleEncodeLength(tok->length, tok->from);
+		StyleEncodeSource(tok->length, token_from(tok));
 		StylePop(); /* html --> */
-		printf("](#%s%s-%x)", md_fragment_extra, division_strings[divn],
-			fnv_32a_str(StyleEncodeLengthRawToBuffer(tok->length, tok->from)));
+		SinkPrintf("](#%s%s-%x)", md_fragment_extra, division_strings[divn],
+			hash);
 	}
 	*ptoken = TokenArrayNext(tokens, tok);
 	return 1;
@@ -320,38 +352,44 @@ OUT(link) {
 		if(turl->symbol == URL) break;
 	}
 	/* We want to open this file to check if it's on the up-and-up. */
-	if(!(errno = 0, fn = PathFromHere(turl->length, turl->from)))
+	if(!(errno = 0, fn = PathFromHere(report->path, turl->length,
+		token_from(turl))))
 		{ if(errno) goto catch; else goto raw; }
-	if(!(fp = fopen(fn, "r"))) { perror(fn); errno = 0; goto raw; } fclose(fp);
+	if(!DependAdd(fn)) goto catch;
+	if(!(fp = fopen(fn, "r"))) { CdocPerror(fn); errno = 0; goto raw; }
+	fclose(fp);
 	/* Actually use the entire path. */
-	if(!(errno = 0, fn = PathFromOutput(turl->length, turl->from)))
+	if(!(errno = 0, fn = PathFromOutput(report->path, turl->length,
+		token_from(turl))))
 		{ if(errno) goto catch; else goto raw; }
 	fn_len = strlen(fn);
 	assert(fn_len < INT_MAX);
 	if(CdocGetDebug() & DBG_OUTPUT)
-		fprintf(stderr, "%s: local link %.*s.\n", pos(t), (int)fn_len, fn);
+		fprintf(CdocGetErr(), "%s: local link %.*s.\n", pos(t),
+		(int)fn_len, fn);
 	goto output;
 raw:
 	/* Maybe it's an external link? Just put it unmolested. */
-	fn = turl->from;
+	fn = token_from(turl);
 	fn_len = turl->length;
 	if(CdocGetDebug() & DBG_OUTPUT)
-		fprintf(stderr, "%s: absolute link %.*s.\n", pos(t), (int)fn_len, fn);
+		fprintf(CdocGetErr(), "%s: absolute link %.*s.\n", pos(t),
+		(int)fn_len, fn);
 output:
 	assert(fn_len <= INT_MAX);
-	if(f == OUT_HTML) printf("<a href = \"%.*s\">", (int)fn_len, fn);
-	else printf("[");
+	if(f == OUT_HTML) SinkPrintf("<a href = \"%.*s\">", (int)fn_len, fn);
+	else SinkPuts("[");
 	/* This is html even in Md because it's surrounded by `a`. */
 	StylePush(ST_TO_HTML), StylePush(ST_PLAIN);
 	for(text = TokenArrayNext(tokens, t); text->symbol != URL; )
 		if(!(text = print_token(tokens, text))) goto catch;
 	StylePop(), StylePop();
-	if(f == OUT_HTML) printf("</a>");
-	else printf("](%.*s)", (int)fn_len, fn);
+	if(f == OUT_HTML) SinkPuts("</a>");
+	else SinkPrintf("](%.*s)", (int)fn_len, fn);
 	success = 1;
 	goto finally;
 catch:
-	fprintf(stderr, "%s: expected `[description](url)`.\n", pos(t));
+	fprintf(CdocGetErr(), "%s: expected `[description](url)`.\n", pos(t));
 finally:
 	*ptoken = TokenArrayNext(tokens, turl);
 	return success;
@@ -367,38 +405,42 @@ OUT(image) {
 	/* The expected format is IMAGE_START [^URL]* URL. */
 	for(turl = TokenArrayNext(tokens, t); turl->symbol != URL;
 		turl = TokenArrayNext(tokens, turl)) if(!turl) goto catch;
-	printf("%s", f == OUT_HTML ? "<img alt = \"" : "![");
+	SinkPuts(f == OUT_HTML ? "<img alt = \"" : "![");
 	/* This is html even in Md. */
 	StylePush(ST_TO_HTML), StylePush(ST_PLAIN);
 	for(text = TokenArrayNext(tokens, t); text->symbol != URL; )
 		if(!(text = print_token(tokens, text))) goto catch;
 	StylePop(), StylePop();
 	/* We want to open this file to check if it's on the up-and-up. */
-	if(!(errno = 0, fn = PathFromHere(turl->length, turl->from)))
+	if(!(errno = 0, fn = PathFromHere(report->path, turl->length,
+		token_from(turl))))
 		{ if(errno) goto catch; else goto raw; }
+	if(!DependAdd(fn)) goto catch;
 	if(!ImageDimension(fn, &width, &height)) goto raw;
 	/* We want the path to print, now. */
-	if(!(errno = 0, fn = PathFromOutput(turl->length, turl->from)))
+	if(!(errno = 0, fn = PathFromOutput(report->path, turl->length,
+		token_from(turl))))
 		{ if(errno) goto catch; else goto raw; }
 	if(CdocGetDebug() & DBG_OUTPUT)
-		fprintf(stderr, "%s: local image %s.\n", pos(t), fn);
+		fprintf(CdocGetErr(), "%s: local image %s.\n", pos(t), fn);
 	if(f == OUT_HTML) {
-		printf("\" src = \"%s\" width = %u height = %u>", fn, width, height);
+		SinkPrintf("\" src = \"%s\" width = %u height = %u>",
+			fn, width, height);
 	} else {
-		printf("](%s)", fn);
+		SinkPrintf("](%s)", fn);
 	}
 	success = 1;
 	goto finally;
 raw:
 	/* Maybe it's an external link? */
-	if(CdocGetDebug() & DBG_OUTPUT) fprintf(stderr, "%s: remote image %.*s.\n",
-		pos(t), turl->length, turl->from);
-	printf("%s%.*s%s", f == OUT_HTML ? "\" src = \"" : "](",
-		turl->length, turl->from, f == OUT_HTML ? "\">" : ")");
+	if(CdocGetDebug() & DBG_OUTPUT) fprintf(CdocGetErr(),
+		"%s: remote image %.*s.\n", pos(t), turl->length, token_from(turl));
+	SinkPrintf("%s%.*s%s", f == OUT_HTML ? "\" src = \"" : "](",
+		turl->length, token_from(turl), f == OUT_HTML ? "\">" : ")");
 	success = 1;
 	goto finally;
 catch:
-	fprintf(stderr, "%s: expected `[description](url)`.\n", pos(t));
+	fprintf(CdocGetErr(), "%s: expected `[description](url)`.\n", pos(t));
 finally:
 	*ptoken = TokenArrayNext(tokens, turl);
 	return success;
@@ -407,7 +449,7 @@ OUT(nbsp) {
 	const struct Token *const t = *ptoken;
 	assert(tokens && t && t->symbol == NBSP && !is_buffer);
 	StyleFlushSymbol(t->symbol);
-	printf("&nbsp;");
+	SinkPuts("&nbsp;");
 	*ptoken = TokenArrayNext(tokens, t);
 	return 1;
 }
@@ -415,7 +457,7 @@ OUT(nbthinsp) {
 	const struct Token *const t = *ptoken;
 	assert(tokens && t && t->symbol == NBTHINSP && !is_buffer);
 	StyleFlushSymbol(t->symbol);
-	printf("&#8239;" /* "&thinsp;" <- breaking? */);
+	SinkPuts("&#8239;" /* "&thinsp;" <- breaking? */);
 	*ptoken = TokenArrayNext(tokens, t);
 	return 1;
 }
@@ -426,7 +468,7 @@ OUT(mathcalo) {
 	/* Omicron. It looks like a stylised "O"? The actual is "&#120030;" but
 	 good luck finding a font that supports that. If one was using JavaScript
 	 and had a constant connection, we could use MathJax. */
-	printf("&#927;" /* "O" */);
+	SinkPuts("&#927;" /* "O" */);
 	*ptoken = TokenArrayNext(tokens, t);
 	return 1;
 }
@@ -434,7 +476,7 @@ OUT(ctheta) {
 	const struct Token *const t = *ptoken;
 	assert(tokens && t && t->symbol == CTHETA && !is_buffer);
 	StyleFlushSymbol(t->symbol);
-	printf("&#920;" /* "&Theta;" This is supported on more browsers. */);
+	SinkPuts("&#920;" /* "&Theta;" This is supported on more browsers. */);
 	*ptoken = TokenArrayNext(tokens, t);
 	return 1;
 }
@@ -442,7 +484,7 @@ OUT(comega) {
 	const struct Token *const t = *ptoken;
 	assert(tokens && t && t->symbol == COMEGA && !is_buffer);
 	StyleFlushSymbol(t->symbol);
-	printf("&#937;" /* "&Omega;" */);
+	SinkPuts("&#937;" /* "&Omega;" */);
 	*ptoken = TokenArrayNext(tokens, t);
 	return 1;
 }
@@ -450,7 +492,7 @@ OUT(times) {
 	const struct Token *const t = *ptoken;
 	assert(tokens && t && t->symbol == TIMES && !is_buffer);
 	StyleFlushSymbol(t->symbol);
-	printf("&#215;");
+	SinkPuts("&#215;");
 	*ptoken = TokenArrayNext(tokens, t);
 	return 1;
 }
@@ -458,7 +500,7 @@ OUT(cdot) {
 	const struct Token *const t = *ptoken;
 	assert(tokens && t && t->symbol == CDOT && !is_buffer);
 	StyleFlushSymbol(t->symbol);
-	printf("&#183;" /* &middot; */);
+	SinkPuts("&#183;" /* &middot; */);
 	*ptoken = TokenArrayNext(tokens, t);
 	return 1;
 }
@@ -481,7 +523,7 @@ OUT(pre) {
 	if(StyleIsTop(ST_PRELINE)) StylePopStrong();
 	StylePush(ST_PRE), StylePush(ST_PRELINE);
 	StyleFlushSymbol(t->symbol);
-	StyleEncodeLength(t->length, t->from);
+	StyleEncodeSource(t->length, token_from(t));
 	*ptoken = TokenArrayNext(tokens, t);
 	return 1;
 }
@@ -496,7 +538,7 @@ static const OutFn symbol_outs[] = { SYMBOL(PARAM6C) };
 /** Prints one [multi-]token sequence.
  @param[tokens] The token array that `token` is a part of.
  @param[token] The start token.
- @param[a] If non-null, prints to a string instead of `stdout`. Only variable
+ @param[a] If non-null, prints to a string instead of the sink. Only variable
  name tokens support this.
  @throws[EILSEQ] Sequence error. Must detect with `errno`.
  @return The next token. */
@@ -505,7 +547,7 @@ static const struct Token *print_token_choose(
 	const struct Token *token, const int is_buffer) {
 	const OutFn sym_out = symbol_outs[token->symbol];
 	assert(tokens && token);
-	if(!sym_out) return fprintf(stderr, "%s: symbol output undefined.\n",
+	if(!sym_out) return fprintf(CdocGetErr(), "%s: symbol output undefined.\n",
 		pos(token)), TokenArrayNext(tokens, token);
 	if(!sym_out(tokens, &token, is_buffer)) { errno = EILSEQ; return 0; }
 	return token;
@@ -559,14 +601,6 @@ static void print_tokens(const struct TokenArray *const tokens) {
 
 
 
-/** Prints the documentation part of `brief` and erases it. */
-static void print_brief(void) {
-	print_tokens(&brief);
-	TokenArrayClear(&brief);
-}
-
-
-
 typedef int (*DivisionPredicate)(const enum Division);
 
 /** @implements DivisionPredicate */
@@ -603,7 +637,7 @@ static int segment_attribute_exists(const struct Segment *const segment,
 /** @return Is `division` in the report? */
 static int division_exists(const enum Division division) {
 	struct Segment *segment = 0;
-	while((segment = SegmentArrayNext(&report, segment)))
+	while((segment = SegmentArrayNext(&report->segments, segment)))
 		if(segment->division == division) return 1;
 	return 0;
 }
@@ -613,14 +647,14 @@ static void division_act(const enum Division division,
 	void (*act)(const struct Segment *const segment)) {
 	const struct Segment *segment = 0;
 	assert(act);
-	while((segment = SegmentArrayNext(&report, segment)))
+	while((segment = SegmentArrayNext(&report->segments, segment)))
 		if(segment->division == division) act(segment);
 }
 
 /** @return Is `attribute_symbol` in the report? (needed for `@licence`.) */
 static int attribute_exists(const enum Symbol attribute_symbol) {
 	struct Segment *segment = 0;
-	while((segment = SegmentArrayNext(&report, segment)))
+	while((segment = SegmentArrayNext(&report->segments, segment)))
 		if(segment_attribute_exists(segment, attribute_symbol)) return 1;
 	return 0;
 }
@@ -650,7 +684,7 @@ static void print_best_guess_at_modifiers(const struct Segment *const segment) {
 		if(code->symbol == LPAREN) {
 			StyleSeparate();
 			StylePush(ST_EM), StyleFlush();
-			printf("function");
+			SinkPuts("function");
 			StylePop();
 			return;
 		}
@@ -658,105 +692,71 @@ static void print_best_guess_at_modifiers(const struct Segment *const segment) {
 	}
 }
 
-/** Scan the `str`, used below. */
-static void scan_doc_string(const char *const str) {
-	struct Scanner *scan;
-	assert(str);
-	/* Generally this will be a bug in the programme, not in the input. */
-	if(!(scan = Scanner("string", str, &notify_brief, SSDOC)))
-		{ perror(str); assert(0); exit(EXIT_FAILURE); return; }
-	StyleFlush(), print_brief();
-	Scanner_(&scan);
+/** Starts a link to a fragment with `text`, which is in HTML; the link is in
+ the effective format. The fragment, in the format of the document, is
+ printed next, then <fn:link_to_fragment_end>. */
+static void link_to_fragment_begin(const char *const text) {
+	assert(text);
+	StyleFlushSymbol(LINK_START);
+	if(StyleFormat() == OUT_HTML) SinkPuts("<a href = \"#");
+	else SinkPrintf("[%s](#", text);
 }
 
-static unsigned log2u(unsigned i) {
-	unsigned log = 0;
-	while(i) log++, i >>= 1;
-	return log;
+/** Ends the link that <fn:link_to_fragment_begin> started with `text`. */
+static void link_to_fragment_end(const char *const text) {
+	assert(text);
+	if(StyleFormat() == OUT_HTML) SinkPrintf("\">%s</a>", text);
+	else SinkPutc(')');
 }
 
-/** For computing the number of digits. */
-static unsigned compute_digits_x(unsigned x) {
-	unsigned digits = (log2u(x) + 3) >> 2;
-	/*fprintf(stderr, "digits log_16(%x) -> %u\n", x, digits);*/
-	return digits ? digits : 1;
-}
-
-/* @param[label] Un-escaped label. */
-static void print_fragment_for(const enum Division d, const char *const label) {
+/** @param[segment] Must be labelled. */
+static void print_fragment_for(const struct Segment *const segment) {
+	const char *const division = division_strings[segment->division],
+		*const text = label_html(segment);
+	link_to_fragment_begin(text);
 	/* `effective_format` is NOT the thing we need; we need to raw format for
 	 the link. */
-	const enum Format f = CdocGetFormat();
-	const unsigned hash = fnv_32a_str(label);
-	/* GCC is too smart but not smart enough. */
-	const char *const fmt_html = "[%s](#%s:%s)",
-		*const fmt_md = "[%s](#%s%s-%x)",
-		*const division = division_strings[d];
-	const size_t label_len = strlen(label), division_len = strlen(division),
-		md_fragment_extra_len = strlen(md_fragment_extra),
-		fmt_len = (f == OUT_HTML) ? strlen("[](#:)") + 2 * label_len
-		+ division_len : strlen("[](#-)") + label_len + md_fragment_extra_len
-		+ division_len + compute_digits_x(hash);
-	size_t len;
-	char *b;
-	assert(label);
-	/* (Potentally) calling this with `label` as the other buffer. */
-	BufferSwap();
-	BufferClear();
-	if(!(b = BufferPrepare(fmt_len)))
-		{ perror(label); assert(0); exit(EXIT_FAILURE); return; }
-	len = f == OUT_HTML ? sprintf(b, fmt_html, label, division, label)
-		: sprintf(b, fmt_md, label, md_fragment_extra, division, hash);
-	assert(len == fmt_len);
-	scan_doc_string(b);
-	BufferSwap();
+	if(StyleDocumentFormat() == OUT_HTML)
+		SinkPrintf("%s:%s", division, label_raw(segment));
+	else SinkPrintf("%s%s-%x", md_fragment_extra, division, segment->hash);
+	link_to_fragment_end(text);
 }
 
 static void print_custom_heading_fragment_for(const char *const division,
 	const char *const desc) {
-	const enum Format f = StyleFormat();
-	/* "*.0s" does not work on all libraries? */
-	const char *const fmt_html = "[%s](#%s:)", *const fmt_md = "[%s](#%s%s)";
-	const size_t fmt_len = (f == OUT_HTML)
-		? strlen("[](#:)") + strlen(desc) + strlen(division)
-		: strlen("[](#)") + strlen(desc) + strlen(md_fragment_extra)
-		+ strlen(division);
-	size_t len;
-	char *b;
+	const char *text;
 	assert(division && desc);
 	BufferClear();
-	if(!(b = BufferPrepare(fmt_len)))
-		{ perror(division); assert(0); exit(EXIT_FAILURE); return; }
-	len = (f == OUT_HTML) ? sprintf(b, fmt_html, desc, division) :
-		sprintf(b, fmt_md, desc, md_fragment_extra, division);
-	assert(len == fmt_len);
-	scan_doc_string(b);
+	StylePush(ST_TO_HTML);
+	StyleEncodeLengthCatToBuffer((int)strlen(desc), desc);
+	StylePop();
+	link_to_fragment_begin(text = BufferGet());
+	if(StyleFormat() == OUT_HTML) SinkPrintf("%s:", division);
+	else SinkPrintf("%s%s", md_fragment_extra, division);
+	link_to_fragment_end(text);
 }
 
 static void print_heading_fragment_for(const enum Division d) {
 	print_custom_heading_fragment_for(division_strings[d], division_desc[d]);
 }
 
-/** @param[label] In HTML. */
-static void print_anchor_for(const enum Division d, const char *const label) {
+/** @param[segment] Must be labelled. */
+static void print_anchor_for(const struct Segment *const segment) {
 	const enum Format f = StyleFormat();
-	const char *const division = division_strings[d];
-	assert(label);
+	const char *const division = division_strings[segment->division],
+		*const label = label_raw(segment);
 	StylePush(ST_H3), StyleFlush();
-	printf("<a ");
+	SinkPuts("<a ");
 	if(f == OUT_HTML) {
-		printf("id = \"%s:%s\" name = \"%s:%s\"",
+		SinkPrintf("id = \"%s:%s\" name = \"%s:%s\"",
 			division, label, division, label);
 	} else {
-		const unsigned hash = fnv_32a_str(label);
-		printf("id = \"%s%s-%x\" name = \"%s%s-%x\"", md_fragment_extra,
-			division, hash, md_fragment_extra, division, hash);
+		SinkPrintf("id = \"%s%s-%x\" name = \"%s%s-%x\"", md_fragment_extra,
+			division, segment->hash, md_fragment_extra, division,
+			segment->hash);
 	}
-	fputc('>', stdout);
-	StylePush(ST_TO_HTML); /* The format is HTML because it's in an HTML tag. */
-	StyleEncode(label);
-	StylePop();
-	fputs("</a>", stdout);
+	/* The format is HTML because it's in an HTML tag. */
+	SinkPrintf(">%s</a>", label_html(segment));
 	StylePop(); /* h2 */
 }
 
@@ -765,12 +765,12 @@ static void print_custom_heading_anchor_for(const char *const division,
 	assert(division && desc);
 	StylePush(ST_H2);
 	StyleFlush();
-	printf("<a ");
-	(StyleFormat() == OUT_HTML)
-		? printf("id = \"%s:\" name = \"%s:\"", division, division)
-		: printf("id = \"%s%s\" name = \"%s%s\"", md_fragment_extra, division,
-		md_fragment_extra, division);
-	printf(">%s</a>", desc);
+	SinkPuts("<a ");
+	if(StyleFormat() == OUT_HTML)
+		SinkPrintf("id = \"%s:\" name = \"%s:\"", division, division);
+	else SinkPrintf("id = \"%s%s\" name = \"%s%s\"", md_fragment_extra,
+		division, md_fragment_extra, division);
+	SinkPrintf(">%s</a>", desc);
 	StylePop(); /* h2 */
 }
 
@@ -781,23 +781,14 @@ static void print_heading_anchor_for(enum Division d) {
 /** Toc subcategories. */
 static void print_toc_extra(const enum Division d) {
 	struct Segment *segment = 0;
-	size_t *idxs;
-	struct Token *params;
-	const char *b;
-	printf(": ");
+	SinkPuts(": ");
 	StylePush(ST_CSV), StylePush(ST_NO_STYLE);
-	while((segment = SegmentArrayNext(&report, segment))) {
+	while((segment = SegmentArrayNext(&report->segments, segment))) {
 		if(segment->division != d) continue;
-		if(!IndexArraySize(&segment->code_params)) { fprintf(stderr,
+		if(!segment->is_labelled) { fprintf(CdocGetErr(),
 			"%s: segment has no title.\n", divisions[segment->division]);
 			continue; }
-		idxs = IndexArrayGet(&segment->code_params);
-		params = TokenArrayGet(&segment->code);
-		assert(idxs[0] < TokenArraySize(&segment->code));
-		StylePush(ST_TO_RAW);
-		b = print_token_s(&segment->code, params + idxs[0]);
-		StylePop();
-		print_fragment_for(d, b);
+		print_fragment_for(segment);
 		StylePopPush();
 	}
 	StylePop(), StylePop();
@@ -814,25 +805,20 @@ static void segment_att_print_all(const struct Segment *const segment,
 	if(!show) return;
 	/* fixme */
 	if(CdocGetDebug() & DBG_ERASE)
-		fprintf(stderr, "segment_att_print_all segment %s and symbol %s.\n", divisions[segment->division], symbols[symbol]);
+		fprintf(CdocGetErr(), "segment_att_print_all segment %s and symbol %s.\n", divisions[segment->division], symbols[symbol]);
 	while((attribute = AttributeArrayNext(&segment->attributes, attribute))) {
-		size_t *pindex;
 		if(attribute->token.symbol != symbol
 		   || (match && !any_token(&attribute->header, match))) continue;
 		StyleFlush();
 		if(show & SHOW_WHERE) {
-			if((pindex = IndexArrayNext(&segment->code_params, 0))
-			   && *pindex < TokenArraySize(&segment->code)) {
-				const struct Token *token
-					= TokenArrayGet(&segment->code) + *pindex;
-				print_fragment_for(segment->division,
-					print_token_s(&segment->code, token));
+			if(segment->is_labelled) {
+				print_fragment_for(segment);
 			} else {
 				/* Not going to happen -- cull takes care of it. */
-				printf("%s", division_strings[segment->division]);
+				SinkPuts(division_strings[segment->division]);
 			}
 		}
-		if(show == SHOW_ALL) fputs(": ", stdout);
+		if(show == SHOW_ALL) SinkPuts(": ");
 		if(show & SHOW_TEXT) print_tokens(&attribute->contents);
 		StylePopPush();
 		/* Only do one if `SHOW_TEXT` is not set; in practice, this affects
@@ -848,7 +834,7 @@ static void div_att_print(const DivisionPredicate div_pred,
 	const enum Symbol symbol, const enum AttShow show) {
 	struct Segment *segment = 0;
 	if(!show) return;
-	while((segment = SegmentArrayNext(&report, segment)))
+	while((segment = SegmentArrayNext(&report->segments, segment)))
 		if(!div_pred || div_pred(segment->division))
 			segment_att_print_all(segment, symbol, 0, show);
 }
@@ -860,7 +846,7 @@ static void dl_segment_att(const struct Segment *const segment,
 	if((match && !segment_attribute_match_exists(segment, attribute, match))
 	   || (!match && !segment_attribute_exists(segment, attribute))) return;
 	StylePush(ST_DT), StylePush(ST_PLAIN), StyleFlush();
-	printf("%s:", symbol_attribute_titles[attribute]);
+	SinkPrintf("%s:", symbol_attribute_titles[attribute]);
 	if(match) StyleSeparate(), StylePush(ST_EM),
 		print_token(&segment->code, match), StylePop();
 	StylePop(), StylePop();
@@ -868,7 +854,7 @@ static void dl_segment_att(const struct Segment *const segment,
 	segment_att_print_all(segment, attribute, match, SHOW_TEXT);
 	/* fixme */
 	if(CdocGetDebug() & DBG_ERASE)
-		fprintf(stderr, "dl_segment_att for %s.\n", symbols[attribute]);
+		fprintf(CdocGetErr(), "dl_segment_att for %s.\n", symbols[attribute]);
 	StylePop(), StylePop(), StylePop();
 }
 
@@ -879,10 +865,10 @@ static void dl_preamble_att(const enum Symbol attribute,
 	assert(!StyleIsEmpty());
 	/* fixme */
 	if(CdocGetDebug() & DBG_ERASE)
-		fprintf(stderr, "dl_preamble_att for %s.\n", symbols[attribute]);
+		fprintf(CdocGetErr(), "dl_preamble_att for %s.\n", symbols[attribute]);
 	if(!attribute_exists(attribute)) return;
 	StylePush(ST_DT), StyleFlush();
-	printf("%s:", symbol_attribute_titles[attribute]);
+	SinkPrintf("%s:", symbol_attribute_titles[attribute]);
 	StylePop();
 	StylePush(ST_DD), StylePush(p), StylePush(ST_PLAIN);
 	div_att_print(&is_div_preamble, attribute, SHOW_TEXT);
@@ -894,7 +880,7 @@ static void dl_preamble_att(const enum Symbol attribute,
 static void dl_segment_specific_att(const struct Attribute *const attribute) {
 	assert(attribute);
 	StylePush(ST_DT), StylePush(ST_PLAIN), StyleFlush();
-	printf("%s:", symbol_attribute_titles[attribute->token.symbol]);
+	SinkPrintf("%s:", symbol_attribute_titles[attribute->token.symbol]);
 	if(TokenArraySize(&attribute->header)) {
 		const struct Token *token = 0;
 		StyleSeparate();
@@ -915,25 +901,21 @@ static void dl_segment_specific_att(const struct Attribute *const attribute) {
  @implements division_act */
 static void segment_print_all(const struct Segment *const segment) {
 	const struct Token *param;
-	const char *b;
 	assert(segment && segment->division != DIV_PREAMBLE);
 	StylePush(ST_DIV);
 
 	/* The title is generally the first param. Only single-words. */
-	if((param = param_no(segment, 0))) {
-		StylePush(ST_TO_RAW); /* Anchors are always raw. */
-		b = print_token_s(&segment->code, param);
-		StylePop();
-		print_anchor_for(segment->division, b);
+	if(segment->is_labelled) {
+		print_anchor_for(segment);
 		StylePush(ST_P), StylePush(ST_TO_HTML);
 		StyleFlush();
-		printf("<code>");
+		SinkPuts("<code>");
 		highlight_tokens(&segment->code, &segment->code_params);
-		printf("</code>");
+		SinkPuts("</code>");
 		StylePopStrong();
 	} else {
 		StylePush(ST_H3), StyleFlush();
-		printf("Unknown");
+		SinkPuts("Unknown");
 		StylePopStrong();
 	}
 
@@ -975,10 +957,10 @@ static void segment_print_all(const struct Segment *const segment) {
 
 
 
-/** Outputs a report.
+/** Outputs the bound `report`.
  @throws[EILSEQ] Sequence error.
  @return Success. */
-int ReportOut(void) {
+static int report_out(void) {
 	const char *const summary = "summary",
 		*const summary_desc = "Function Summary",
 		*const license = "license",
@@ -991,16 +973,17 @@ int ReportOut(void) {
 		is_license = attribute_exists(ATT_LICENSE);
 	const struct Segment *segment = 0;
 	const int is_html = StyleFormat() == OUT_HTML;
-	const char *const in_fn = CdocGetInput(),
+	const char *const in_fn = report->in_fn,
 		*const base_fn = strrchr(in_fn, *path_dirsep),
 		*const title = base_fn ? base_fn + 1 : in_fn;
 
 	assert(in_fn && StyleIsEmpty());
+	if(!index_update() || !index_catalog(StyleDocumentFormat())) return 0;
 
 	/* Set `errno` here so that we don't have to test output each time. */
 	errno = 0;
 	if(is_html) {
-		printf("<!doctype html public \"-//W3C//DTD HTML 4.01//EN\" "
+		SinkPuts("<!doctype html public \"-//W3C//DTD HTML 4.01//EN\" "
 			"\"http://www.w3.org/TR/html4/strict.dtd\">\n\n"
 			"<html>\n\n"
 			"<head>\n"
@@ -1015,7 +998,7 @@ int ReportOut(void) {
 			"\tdiv {\n"
 			"\t\tmargin:  4px 0;\n"
 			"\t\tpadding: 0 4px 4px 4px;\n");
-		printf("\t}\n"
+		SinkPrintf("\t}\n"
 			"\ttable      { width: 100%%; }\n"
 			"\ttd         { padding: 4px; }\n"
 			"\th3, h1 {\n"
@@ -1031,7 +1014,7 @@ int ReportOut(void) {
 		StylePush(ST_TITLE), StylePush(ST_SSV), StylePush(ST_PLAIN);
 		StyleFlush(), StyleEncode(title), StylePopStrong();
 		assert(StyleIsEmpty());
-		printf("</head>\n\n"
+		SinkPuts("</head>\n\n"
 			"<body>\n\n");
 	}
 	/* Title. */
@@ -1068,7 +1051,7 @@ int ReportOut(void) {
 		StylePush(ST_DIV), StylePush(ST_NO_STYLE);
 		print_heading_anchor_for(DIV_PREAMBLE);
 		StylePush(ST_P);
-		while((segment = SegmentArrayNext(&report, segment))) {
+		while((segment = SegmentArrayNext(&report->segments, segment))) {
 			if(segment->division != DIV_PREAMBLE) continue;
 			print_tokens(&segment->doc);
 			StylePopPush();
@@ -1076,7 +1059,7 @@ int ReportOut(void) {
 		StylePopStrong(); /* P */
 		StylePush(ST_DL);
 		/* `ATT_TITLE` is above. */
-		while((segment = SegmentArrayNext(&report, segment))) {
+		while((segment = SegmentArrayNext(&report->segments, segment))) {
 			const struct Attribute *att = 0;
 			if(segment->division != DIV_PREAMBLE) continue;
 			while((att = AttributeArrayNext(&segment->attributes, att))) {
@@ -1118,37 +1101,34 @@ int ReportOut(void) {
 		print_custom_heading_anchor_for(summary, summary_desc);
 		StylePush(ST_TO_HTML);
 		StyleFlush();
-		printf("<table>\n\n"
+		SinkPuts("<table>\n\n"
 			"<tr><th>Modifiers</th><th>Function Name</th>"
 			"<th>Argument List</th></tr>\n\n");
-		while((segment = SegmentArrayNext(&report, segment))) {
+		while((segment = SegmentArrayNext(&report->segments, segment))) {
 			struct Token *params;
 			size_t *idxs, idxn, idx, paramn;
-			const char *b;
 			if(segment->division != DIV_FUNCTION
 				|| !(idxn = IndexArraySize(&segment->code_params))) continue;
 			idxs = IndexArrayGet(&segment->code_params);
 			params = TokenArrayGet(&segment->code);
 			paramn = TokenArraySize(&segment->code);
 			assert(idxs[0] < paramn);
-			printf("<tr><td align = right>");
+			SinkPuts("<tr><td align = right>");
 			StylePush(ST_PLAIN);
 			print_best_guess_at_modifiers(segment);
 			StylePop();
-			printf("</td><td>");
-			StylePush(ST_TO_RAW); /* Always get raw; translate after. */
-			b = print_token_s(&segment->code, params + idxs[0]);
-			StylePop();
-			print_fragment_for(DIV_FUNCTION, b);
-			printf("</td><td>");
+			SinkPuts("</td><td>");
+			assert(segment->is_labelled);
+			print_fragment_for(segment);
+			SinkPuts("</td><td>");
 			for(idx = 1; idx < idxn; idx++) {
 				assert(idxs[idx] < paramn);
-				if(idx > 1) printf(", ");
+				if(idx > 1) SinkPuts(", ");
 				print_token(&segment->code, params + idxs[idx]);
 			}
-			printf("</td></tr>\n\n");
+			SinkPuts("</td></tr>\n\n");
 		}
-		printf("</table>\n\n");
+		SinkPuts("</table>\n\n");
 		StylePop(); /* to_html */
 		StylePop(); /* div */
 		assert(StyleIsEmpty());
@@ -1171,8 +1151,18 @@ int ReportOut(void) {
 		StylePopStrong();
 		StylePopStrong();
 	}
-	if(is_html) printf("</body>\n\n"
+	if(is_html) SinkPuts("</body>\n\n"
 		"</html>\n");
 	Style_();
 	return errno ? 0 : 1;
 }
+
+/** Outputs `r` to the sink of this thread in `format`.
+ @throws[EILSEQ] Sequence error.
+ @return Success. */
+int ReportOut(struct Report *const r, const enum Format format) {
+	assert(r);
+	report_use(r);
+	Style(format);
+	return report_out();
+}
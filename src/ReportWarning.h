@@ -30,7 +30,7 @@ static int attribute_okay(const struct Attribute *const attribute) {
 	case ATT_CF: return attribute_use(attribute, 0, 1, 1);
 	case ATT_FIXME: return attribute_use(attribute, 0, 0, 1);
 	case ATT_ALLOW: return attribute_use(attribute, 0, 1, 0); /* Or full. */
-	default: assert((fprintf(stderr, "Not recognised.\n"), 0)); return 0;
+	default: assert((fprintf(CdocGetErr(), "Not recognised.\n"), 0)); return 0;
 	}
 }
 
@@ -96,29 +96,28 @@ static void unused_attribute(const struct Segment *const segment,
 	assert(segment && attributes && symbol);
 	while((attribute = AttributeArrayNext(attributes, attribute))) {
 		if(attribute->token.symbol != symbol) continue;
-		fprintf(stderr, "%s: attribute not used in %s.\n",
+		fprintf(CdocGetErr(), "%s: attribute not used in %s.\n",
 			pos(&attribute->token), divisions[segment->division]);
 	}
 }
 
 static void preamble_used_attribute(const enum Symbol symbol) {
 	const struct Segment *segment = 0;
-	while((segment = SegmentArrayNext(&report, segment))) {
+	while((segment = SegmentArrayNext(&report->segments, segment))) {
 		const struct AttributeArray *const attributes = &segment->attributes;
 		struct Attribute *attribute = 0;
 		if(segment->division != DIV_PREAMBLE) continue;
 		while((attribute = AttributeArrayNext(attributes, attribute)))
 			if(attribute->token.symbol == symbol) return;
 	}
-	fprintf(stderr, "No attribute %s in %s.\n", symbols[symbol],
+	fprintf(CdocGetErr(), "No attribute %s in %s.\n", symbols[symbol],
 		divisions[DIV_PREAMBLE]);
 }
 
 static void warn_internal_link(const struct Token *const token) {
 	enum Division division;
-	const char *a, *b;
-	size_t *fun_index;
-	struct Segment *segment = 0;
+	const char *a;
+	struct CatalogSymbol other;
 	assert(token);
 	switch(token->symbol) {
 		case SEE_FN:      division = DIV_FUNCTION; break;
@@ -127,27 +126,19 @@ static void warn_internal_link(const struct Token *const token) {
 		case SEE_DATA:    division = DIV_DATA;     break;
 		default: return;
 	}
-	BufferSwap();
-	/* Encode the link text. */
-	a = StyleEncodeLengthRawToBuffer(token->length, token->from);
-	BufferSwap();
-	/* Search for it. Not really efficient as it builds up labels from scratch,
-	 then discards them, over and over. */
-	while((segment = SegmentArrayNext(&report, segment))) {
-		const struct Token *compare;
-		/* The "title" is `code[code_params[0]]`. */
-		if(segment->division != division
-			|| !(fun_index = IndexArrayNext(&segment->code_params, 0))
-			|| *fun_index >= TokenArraySize(&segment->code)) continue;
-		compare = TokenArrayGet(&segment->code) + *fun_index;
-		/* Use raw encoding to match raw in `a`. */
-		StylePush(ST_TO_RAW);
-		b = print_token_s(&segment->code, compare);
-		StylePop();
-		if(!strcmp(a, b)) { if(CdocGetDebug() & DBG_OUTPUT) fprintf(stderr,
-			"%s: link okay.\n", pos(token)); return; }
+	/* Encode the link text raw to match the index. */
+	a = StyleEncodeLengthRawToBuffer(token->length, token_from(token));
+	if(index_find(division, a)) {
+		if(CdocGetDebug() & DBG_OUTPUT)
+			fprintf(CdocGetErr(), "%s: link okay.\n", pos(token));
+	} else if(report->out_fn && CatalogFind(division, a, fnv_32a_str(a), &other)
+		&& strcmp(other.output, report->out_fn)) {
+		if(CdocGetDebug() & DBG_OUTPUT) fprintf(CdocGetErr(),
+			"%s: link to %s, from %s:%lu, okay.\n", pos(token), other.output,
+			other.source, other.line);
+	} else {
+		fprintf(CdocGetErr(), "%s: link broken.\n", pos(token));
 	}
-	fprintf(stderr, "%s: link broken.\n", pos(token));
 }
 
 static void warn_segment(const struct Segment *const segment) {
@@ -158,7 +149,7 @@ static void warn_segment(const struct Segment *const segment) {
 	assert(segment);
 	/* Check for empty (or full, as the case may be) attributes. */
 	while((attribute = AttributeArrayNext(&segment->attributes, attribute)))
-		if(!attribute_okay(attribute)) fprintf(stderr,
+		if(!attribute_okay(attribute)) fprintf(CdocGetErr(),
 		"%s: attribute not used correctly.\n", pos(&attribute->token));
 	/* Check all text for undefined references. */
 	while((token = TokenArrayNext(&segment->doc, token)))
@@ -175,14 +166,15 @@ static void warn_segment(const struct Segment *const segment) {
 		/* Check for code. This one will never be triggered unless one fiddles
 		 with the parser. */
 		if(!TokenArraySize(&segment->code))
-			fprintf(stderr, "%s: function with no code?\n", pos(fallback));
+			fprintf(CdocGetErr(), "%s: function with no code?\n",
+			pos(fallback));
 		/* Check for public methods without documentation. */
 		if(!TokenArraySize(&segment->doc)
 			&& !AttributeArraySize(&segment->attributes)
 			&& !is_static(&segment->code))
-			fprintf(stderr, "%s: no documentation.\n", pos(fallback));
+			fprintf(CdocGetErr(), "%s: no documentation.\n", pos(fallback));
 		/* No function title? */
-		if(IndexArraySize(&segment->code_params) < 1) fprintf(stderr,
+		if(IndexArraySize(&segment->code_params) < 1) fprintf(CdocGetErr(),
 			"%s: unable to extract function name.\n", pos(fallback));
 		/* Unused in function. */
 		unused_attribute(segment, ATT_SUBTITLE);
@@ -195,7 +187,8 @@ static void warn_segment(const struct Segment *const segment) {
 			if(attribute->token.symbol != ATT_PARAM) continue;
 			while((match = TokenArrayNext(&attribute->header, match)))
 				if(!match_function_params(match, segment))
-				fprintf(stderr, "%s: extraneous parameter.\n", pos(match));
+				fprintf(CdocGetErr(), "%s: extraneous parameter.\n",
+				pos(match));
 		}
 		/* Check for params that are undocumented. */
 		code_param = IndexArrayNext(&segment->code_params, 0);
@@ -206,13 +199,13 @@ static void warn_segment(const struct Segment *const segment) {
 			if(!match_param_attributes(param, &segment->attributes)
 				&& !match_tokens(param, &segment->doc)
 				&& !match_attribute_contents(param, &segment->attributes,
-				ATT_RETURN)) fprintf(stderr,
+				ATT_RETURN)) fprintf(CdocGetErr(),
 				"%s: parameter may be undocumented.\n", pos(param));
 		}
 		break;
 	case DIV_PREAMBLE:
 		/* Should not have params. */
-		if(IndexArraySize(&segment->code_params)) fprintf(stderr,
+		if(IndexArraySize(&segment->code_params)) fprintf(CdocGetErr(),
 			"%s: params useless in preamble.\n", pos(fallback));
 		/* Unused in preamble. */
 		unused_attribute(segment, ATT_RETURN);
@@ -223,7 +216,7 @@ static void warn_segment(const struct Segment *const segment) {
 		break;
 	case DIV_TAG:
 		/* Should have one or zero. */
-		if(IndexArraySize(&segment->code_params) > 1) fprintf(stderr,
+		if(IndexArraySize(&segment->code_params) > 1) fprintf(CdocGetErr(),
 			"%s: extracted mutiple tag names.\n", pos(fallback));
 		/* Unused in tags. */
 		unused_attribute(segment, ATT_SUBTITLE);
@@ -236,7 +229,7 @@ static void warn_segment(const struct Segment *const segment) {
 		break;
 	case DIV_TYPEDEF:
 		/* Should have one. */
-		if(IndexArraySize(&segment->code_params) != 1) fprintf(stderr,
+		if(IndexArraySize(&segment->code_params) != 1) fprintf(CdocGetErr(),
 			"%s: unable to extract one typedef name.\n", pos(fallback));
 		/* Unused in typedefs. */
 		unused_attribute(segment, ATT_SUBTITLE);
@@ -249,7 +242,7 @@ static void warn_segment(const struct Segment *const segment) {
 		break;
 	case DIV_DATA:
 		/* Should have one. */
-		if(IndexArraySize(&segment->code_params) != 1) fprintf(stderr,
+		if(IndexArraySize(&segment->code_params) != 1) fprintf(CdocGetErr(),
 			"%s: unable to extract one data name.\n", pos(fallback));
 		/* Unused in data. */
 		unused_attribute(segment, ATT_SUBTITLE);
@@ -266,9 +259,13 @@ static void warn_segment(const struct Segment *const segment) {
 	}
 }
 
-void ReportWarn(void) {
+/** Prints warnings about the documentation in `r` to `CdocGetErr()`. */
+void ReportWarn(struct Report *const r) {
 	struct Segment *segment = 0;
-	while((segment = SegmentArrayNext(&report, segment)))
+	assert(r);
+	report_use(r);
+	if(!index_update()) { CdocPerror("index"); return; }
+	while((segment = SegmentArrayNext(&report->segments, segment)))
 		warn_segment(segment);
 	/* `ATT_AUTHOR` is superseded by `ATT_LICENSE`; really only needed in
 	 multi-author code.
@@ -8,17 +8,34 @@
 enum ScannerState { SSCODE, SSDOC };
 
 struct Scanner;
+struct Text;
 
-typedef int (*ScannerPredicate)(const struct Scanner *);
+typedef int (*ScannerPredicate)(struct Scanner *, void *);
+
+/** A copy of the symbol that the scanner was on; see <fn:ScannerBatch>. */
+struct ScannerToken {
+	enum Symbol symbol;
+	const char *from, *to;
+	int indent_level;
+};
 
 void Scanner_(struct Scanner **const scanner);
 struct Scanner *Scanner(const char *const label, const char *const buffer,
-	const ScannerPredicate notify, const enum ScannerState state);
+	const ScannerPredicate notify, void *const param,
+	const enum ScannerState state);
+enum Symbol ScannerNext(struct Scanner *const scan);
+size_t ScannerBatch(struct Scanner *const scan,
+	struct ScannerToken *const batch, const size_t batch_size);
 enum Symbol ScannerSymbol(const struct Scanner *const scan);
 const char *ScannerFrom(const struct Scanner *const scan);
 const char *ScannerTo(const struct Scanner *const scan);
 const char *ScannerLabel(const struct Scanner *const scan);
+const char *ScannerBuffer(const struct Scanner *const scan);
+const struct Text *ScannerText(const struct Scanner *const scan);
 size_t ScannerLine(const struct Scanner *const scan);
 int ScannerIndentLevel(const struct Scanner *const scan);
+void ScannerLineIndex(struct Scanner *const scan, struct Text *const text);
+void ScannerDocOnly(struct Scanner *const scan);
+void ScannerIgnoreBlock(struct Scanner *const scan);
 
 #endif /* scan --> */
@@ -1,7 +1,12 @@
 #include "Division.h"
 
 struct TokenArray;
+struct Semantic;
 
-int Semantic(const struct TokenArray *const code);
-enum Division SemanticDivision(void);
-void SemanticParams(size_t *const no, const size_t **const array);
+void Semantic_(struct Semantic **const psem);
+struct Semantic *Semantic(void);
+int SemanticParse(struct Semantic *const sem,
+	const struct TokenArray *const code);
+enum Division SemanticDivision(const struct Semantic *const sem);
+void SemanticParams(const struct Semantic *const sem, size_t *const no,
+	const size_t **const array);
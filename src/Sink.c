@@ -0,0 +1,290 @@
+/** @license 2019 Neil Edelman, distributed under the terms of the
+ [MIT License](https://opensource.org/licenses/MIT).
+
+ The output of the report. Everything goes into one large buffer that is
+ flushed in bulk to `stdout`, a file, or memory; with `write` where it's
+ available and `fwrite` otherwise. Before <fn:Sink> is called, the output is
+ `stdout`. Errors are reported through `errno`, like `stdio`. With `writev`,
+ long spans of the source given to <fn:SinkReference> are not copied; the
+ buffer is cut into pieces around them, and they all go out together. Each
+ thread has a sink of it's own.
+
+ @std C89, POSIX.1-2001 `open` `write` `writev` `vsnprintf` */
+
+#if defined(__unix__) || defined(__APPLE__)
+#define SINK_WRITE
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L /* open write writev close vsnprintf */
+#endif
+#endif
+
+#include <stddef.h> /* size_t */
+#include <stdio.h>  /* FILE fopen fwrite fclose vsnprintf vfprintf */
+#include <stdarg.h> /* va_list va_start va_end */
+#include <string.h> /* memcpy strlen */
+#include <assert.h> /* assert */
+#include <errno.h>  /* errno EINTR EDOM */
+#ifdef SINK_WRITE /* <-- write */
+#include <limits.h>    /* IOV_MAX */
+#include <sys/types.h> /* ssize_t */
+#include <sys/stat.h>  /* mode */
+#include <sys/uio.h>   /* writev iovec */
+#include <fcntl.h>     /* open */
+#include <unistd.h>    /* write close STDOUT_FILENO */
+#if defined(IOV_MAX) && IOV_MAX < 64
+#define SINK_IOV IOV_MAX
+#else
+#define SINK_IOV 64
+#endif
+#endif /* write --> */
+#include "ThreadLocal.h"
+#include "Sink.h" /** \include */
+
+#define ARRAY_NAME Char
+#define ARRAY_TYPE char
+#include "Array.h"
+
+enum SinkTarget { SINK_STDOUT, SINK_FILE, SINK_MEMORY };
+
+/* Shorter references are copied; an `iovec` costs about as much. */
+static const size_t sink_reference_min = 64;
+
+/* `size` of `buffer` is pending. The default, all-zero, is `stdout`. If there
+ are references, `iov_size` of `iov` go before `buffer` from `mark`. */
+static THREAD_LOCAL struct {
+	enum SinkTarget target;
+#ifdef SINK_WRITE
+	int fd;
+	struct iovec iov[SINK_IOV];
+	int iov_size;
+	size_t mark;
+#else
+	FILE *fp;
+#endif
+	struct CharArray memory, spill;
+	size_t size;
+	char buffer[1 << 16];
+} sink;
+
+/** Writes `length` of `from` directly to the target, bypassing the buffer.
+ @return Success. @throws[write, fwrite, realloc] */
+static int sink_out(const char *from, size_t length) {
+	char *m;
+	if(!length) return 1;
+	if(sink.target == SINK_MEMORY) {
+		if(!(m = CharArrayBuffer(&sink.memory, length))) return 0;
+		memcpy(m, from, length);
+		return 1;
+	}
+#ifdef SINK_WRITE
+	{
+		const int fd = sink.target == SINK_FILE ? sink.fd : STDOUT_FILENO;
+		while(length) {
+			const ssize_t w = write(fd, from, length);
+			if(w < 0) { if(errno == EINTR) continue; return 0; }
+			from += w, length -= (size_t)w;
+		}
+	}
+	return 1;
+#else
+	return fwrite(from, 1, length, sink.target == SINK_FILE ? sink.fp : stdout)
+		== length;
+#endif
+}
+
+#ifdef SINK_WRITE /* <-- write */
+/** Appends `length` of `from` to the pieces; there must be room. */
+static void sink_piece(const char *const from, const size_t length) {
+	/* `writev` doesn't write to `iov_base`. */
+	union { const char *c; void *v; } base;
+	assert(sink.iov_size < SINK_IOV);
+	if(!length) return;
+	base.c = from;
+	sink.iov[sink.iov_size].iov_base = base.v;
+	sink.iov[sink.iov_size].iov_len = length;
+	sink.iov_size++;
+}
+
+/** Writes all the pieces with `writev`, picking up after partial writes.
+ @return Success. @throws[writev] */
+static int sink_pieces_out(void) {
+	const int fd = sink.target == SINK_FILE ? sink.fd : STDOUT_FILENO;
+	struct iovec *iov = sink.iov;
+	int n = sink.iov_size;
+	assert(sink.target != SINK_MEMORY);
+	while(n) {
+		ssize_t w = writev(fd, iov, n);
+		if(w < 0) { if(errno == EINTR) continue; return 0; }
+		while(n && (size_t)w >= iov->iov_len)
+			w -= (ssize_t)iov->iov_len, iov++, n--;
+		if(n) iov->iov_base = (char *)iov->iov_base + w,
+			iov->iov_len -= (size_t)w;
+	}
+	return 1;
+}
+#endif /* write --> */
+
+/** Writes out the buffer and anything it references. On error, what was
+ buffered is lost.
+ @return Success. @throws[write, writev, fwrite, realloc] */
+int SinkFlush(void) {
+	const size_t size = sink.size;
+	sink.size = 0;
+#ifdef SINK_WRITE
+	if(sink.iov_size) {
+		int success;
+		sink_piece(sink.buffer + sink.mark, size - sink.mark);
+		success = sink_pieces_out();
+		sink.iov_size = 0, sink.mark = 0;
+		return success;
+	}
+#endif
+	return sink_out(sink.buffer, size);
+}
+
+/** Flushes and closes the output and frees the memory; subsequent output
+ goes to `stdout`.
+ @return Success. @throws[write, fwrite, close, fclose] */
+int Sink_(void) {
+	int success = SinkFlush();
+	switch(sink.target) {
+	case SINK_STDOUT:
+#ifndef SINK_WRITE
+		if(fflush(stdout) == EOF) success = 0;
+#endif
+		break;
+	case SINK_FILE:
+#ifdef SINK_WRITE
+		if(close(sink.fd) == -1) success = 0;
+#else
+		if(fclose(sink.fp) == EOF) success = 0;
+#endif
+		break;
+	case SINK_MEMORY: break;
+	}
+	sink.target = SINK_STDOUT;
+	CharArray_(&sink.memory);
+	CharArray_(&sink.spill);
+	return success;
+}
+
+/** Closes the previous output and sends output to the file `fn` or, if null,
+ `stdout`.
+ @return Success. @throws[open, fopen] */
+int Sink(const char *const fn) {
+	int success = Sink_();
+	if(!fn) return success;
+	/* Anything that got into `stdio` goes first. */
+	if(fflush(stdout) == EOF) return 0;
+#ifdef SINK_WRITE
+	if((sink.fd = open(fn, O_WRONLY | O_CREAT | O_TRUNC, 0666)) == -1)
+		return 0;
+#else
+	if(!(sink.fp = fopen(fn, "w"))) return 0;
+#endif
+	sink.target = SINK_FILE;
+	return success;
+}
+
+/** Closes the previous output and sends output to memory, where it can be
+ retrieved with <fn:SinkMemoryGet>. */
+void SinkMemory(void) {
+	Sink_();
+	sink.target = SINK_MEMORY;
+}
+
+/** @return What has been written to memory, as a string, valid until the next
+ output. Always returns a string. @throws[realloc] */
+const char *SinkMemoryGet(void) {
+	char *end;
+	assert(sink.target == SINK_MEMORY);
+	if(!SinkFlush() || !(end = CharArrayReserve(&sink.memory, 1))) return "";
+	*end = '\0';
+	return CharArrayGet(&sink.memory);
+}
+
+/** Outputs `length` of `from`. @throws[write, writev, fwrite, realloc] */
+void SinkWrite(const char *const from, const size_t length) {
+	assert(from || !length);
+	if(length > sizeof sink.buffer - sink.size) {
+		if(!SinkFlush()) return;
+		if(length >= sizeof sink.buffer) { sink_out(from, length); return; }
+	}
+	memcpy(sink.buffer + sink.size, from, length);
+	sink.size += length;
+}
+
+/** Outputs `length` of `from`, like <fn:SinkWrite>, but long spans may be
+ written in place instead of copied.
+ @param[from] Must stay valid and unchanged until the next <fn:SinkFlush>,
+ which could be at <fn:Sink_>, such as the source text.
+ @throws[write, writev, fwrite, realloc] */
+void SinkReference(const char *const from, const size_t length) {
+	assert(from || !length);
+#ifdef SINK_WRITE
+	if(length >= sink_reference_min && sink.target != SINK_MEMORY) {
+		/* The pending buffer and `from`, and later the rest of the buffer. */
+		if(sink.iov_size + 3 > SINK_IOV && !SinkFlush()) return;
+		sink_piece(sink.buffer + sink.mark, sink.size - sink.mark);
+		sink.mark = sink.size;
+		sink_piece(from, length);
+		return;
+	}
+#endif
+	SinkWrite(from, length);
+}
+
+/** Outputs the string `str`. @throws[write, writev, fwrite, realloc] */
+void SinkPuts(const char *const str) {
+	assert(str);
+	SinkWrite(str, strlen(str));
+}
+
+/** Outputs `c`. @throws[write, writev, fwrite, realloc] */
+void SinkPutc(const char c) {
+	if(sink.size >= sizeof sink.buffer && !SinkFlush()) return;
+	sink.buffer[sink.size++] = c;
+}
+
+/** Outputs `format` in the manner of `printf`. Without `vsnprintf`, the buffer
+ is flushed and the output goes straight through `vfprintf`, and output to
+ memory is not supported.
+ @throws[write, fwrite, realloc, vsnprintf, vfprintf]
+ @throws[EDOM] Formatting to memory without `vsnprintf`. */
+void SinkPrintf(const char *const format, ...) {
+	va_list args;
+#ifdef SINK_WRITE
+	int len;
+	char *spill;
+	size_t room = sizeof sink.buffer - sink.size;
+	assert(format);
+	va_start(args, format);
+	len = vsnprintf(sink.buffer + sink.size, room, format, args);
+	va_end(args);
+	if(len < 0) return;
+	if((size_t)len < room) { sink.size += (size_t)len; return; }
+	/* It didn't fit; the terminating null also has to fit. */
+	if(!SinkFlush()) return;
+	if((size_t)len < sizeof sink.buffer) {
+		va_start(args, format);
+		vsnprintf(sink.buffer, sizeof sink.buffer, format, args);
+		va_end(args);
+		sink.size = (size_t)len;
+		return;
+	}
+	/* Larger than the buffer. */
+	CharArrayClear(&sink.spill);
+	if(!(spill = CharArrayBuffer(&sink.spill, (size_t)len + 1))) return;
+	va_start(args, format);
+	vsnprintf(spill, (size_t)len + 1, format, args);
+	va_end(args);
+	sink_out(spill, (size_t)len);
+#else
+	assert(format);
+	if(sink.target == SINK_MEMORY) { errno = EDOM; return; }
+	if(!SinkFlush()) return;
+	va_start(args, format);
+	vfprintf(sink.target == SINK_FILE ? sink.fp : stdout, format, args);
+	va_end(args);
+#endif
+}
@@ -0,0 +1,10 @@
+int Sink(const char *const fn);
+void SinkMemory(void);
+int Sink_(void);
+int SinkFlush(void);
+const char *SinkMemoryGet(void);
+void SinkWrite(const char *const from, const size_t length);
+void SinkReference(const char *const from, const size_t length);
+void SinkPuts(const char *const str);
+void SinkPutc(const char c);
+void SinkPrintf(const char *const format, ...);
@@ -3,14 +3,18 @@
  
  Outputs between tokens based on a hierarchical lazy state; one should call
  this before every token group thing. It also encodes things. Is is really
- strict. */
+ strict. Every thread has it's own state, started by <fn:Style>, so outputs
+ on different threads don't interfere. */
 
-#include <string.h> /* strlen memcpy */
+#include <string.h> /* strlen memcpy memchr */
 #include <stdio.h>  /* fprintf */
 #include <limits.h> /* INT_MAX */
 #include "Cdoc.h"
 #include "Symbol.h"
 #include "Buffer.h"
+#include "Sink.h"
+#include "Escape.h"
+#include "ThreadLocal.h"
 #include "Style.h" /** \include */
 
 /* `SYMBOL` is declared in `Symbol.h`. */
@@ -155,8 +159,9 @@ static void style_to_string(const struct Style *s, char (*const a)[12]) {
 #define ARRAY_STACK
 #include "Array.h"
 
-/** Style stack with more. */
-static struct {
+/** Style stack with more, and the format of the document. */
+static THREAD_LOCAL struct {
+	enum Format format;
 	struct StyleArray styles;
 	int is_before_sep;
 	struct { const struct Punctuate *punctuate; int on; } highlight;
@@ -166,14 +171,14 @@ static struct {
  infinite style-push loop or one's memory is very small and one just happened
  to knick this small piece, this is not going to happen. */
 static void unrecoverable(void)
-	{ perror("Unrecoverable"), fprintf(stderr, "Styles stack: %s.\n",
+	{ CdocPerror("Unrecoverable"), fprintf(CdocGetErr(), "Styles stack: %s.\n",
 	StyleArrayToString(&style.styles)), assert(0), exit(EXIT_FAILURE); }
 
 /** Expects the stack to be bounded. If `will_be_popped`, starts searching one
  spot below the top. */
 static enum Format effective_format_search(const int will_be_popped) {
 	struct Style *s = 0;
-	const enum Format f = CdocGetFormat();
+	const enum Format f = style.format;
 	/* If the style will be popped, don't include it. */
 	if(will_be_popped) s = StyleArrayBack(&style.styles, s);
 	while((s = StyleArrayBack(&style.styles, s)))
@@ -184,15 +189,26 @@ static enum Format effective_format(void) { return effective_format_search(0); }
 static enum Format effective_format_will_be_popped(void)
 	{ return effective_format_search(1); }
 
-/** @return Unlike `CdocGetFormat` which always returns the same thing, this is
- the style format, which could change. */
+/** @return Unlike <fn:StyleDocumentFormat> which always returns the same
+ thing, this is the style format, which could change. */
 enum Format StyleFormat(void) { return effective_format(); }
 
-/** Destructor for styles. */
+/** @return The format of the document on this thread. */
+enum Format StyleDocumentFormat(void) { return style.format; }
+
+/** Destructor for styles on this thread; the format goes back to `OUT_RAW`. */
 void Style_(void) {
 	assert(!StyleArraySize(&style.styles) && !style.highlight.on);
 	StyleArray_(&style.styles);
 	style.is_before_sep = 0;
+	style.format = OUT_RAW;
+}
+
+/** Starts a document in `format` on this thread. Styles that convert to a
+ format, like `ST_TO_RAW`, work without it. */
+void Style(const enum Format format) {
+	assert(!StyleArraySize(&style.styles));
+	style.format = format;
 }
 
 static void push(const struct Punctuate *const p) {
@@ -204,8 +220,8 @@ static void push(const struct Punctuate *const p) {
 	/*printf("<!-- push %s -->", text->name);*/
 	s->punctuate = p;
 	s->lazy = BEGIN;
-	if(CdocGetDebug() & DBG_STYLE) fprintf(stderr, "Push style, now %s.\n",
-		StyleArrayToString(&style.styles));	
+	if(CdocGetDebug() & DBG_STYLE) fprintf(CdocGetErr(),
+		"Push style, now %s.\n", StyleArrayToString(&style.styles));	
 }
 
 /** Push the style `e`. @fixme Failing inexplicably? */
@@ -218,8 +234,8 @@ static void pop(void) {
 	if(!s) unrecoverable();
 	/*printf("<!-- pop %s -->", pop->text->name);*/
 	if(s->lazy == BEGIN) return;
-	fputs(s->punctuate->end, stdout);
-	if(CdocGetDebug() & DBG_STYLE) fprintf(stderr, "Pop style, now %s.\n",
+	SinkPuts(s->punctuate->end);
+	if(CdocGetDebug() & DBG_STYLE) fprintf(CdocGetErr(), "Pop style, now %s.\n",
 		StyleArrayToString(&style.styles));	
 }
 
@@ -274,7 +290,7 @@ void StyleExpect(const enum StylePunctuate p) {
 		char a[12];
 		const enum Format f = effective_format();
 		punctuate_to_string(&punctuates[p][f], &a);
-		fprintf(stderr, "Expected %s.\n", a);
+		fprintf(CdocGetErr(), "Expected %s.\n", a);
 	}
 	unrecoverable();
 }
@@ -289,8 +305,8 @@ void StyleFlushSymbol(const enum Symbol symbol) {
 	while((s = StyleArrayNext(&style.styles, s))) {
 		switch(s->lazy) {
 			case ITEM: continue;
-			case SEPARATE: fputs(s->punctuate->sep, stdout); break;
-			case BEGIN: fputs(s->punctuate->begin, stdout); break;
+			case SEPARATE: SinkPuts(s->punctuate->sep); break;
+			case BEGIN: SinkPuts(s->punctuate->begin); break;
 		}
 		s->lazy = ITEM;
 		style.is_before_sep = 0;
@@ -298,11 +314,11 @@ void StyleFlushSymbol(const enum Symbol symbol) {
 	assert(top->lazy == ITEM);
 	/* If there was no separation, is there an implied separation? */
 	if(style.is_before_sep && symbol_before_sep[symbol])
-		fputs(top->punctuate->sep, stdout);
+		SinkPuts(top->punctuate->sep);
 	style.is_before_sep = symbol_after_sep[symbol];
 	/* Now do the highlight. */
 	if(style.highlight.punctuate && !style.highlight.on)
-		fputs(style.highlight.punctuate->begin, stdout), style.highlight.on = 1;
+		SinkPuts(style.highlight.punctuate->begin), style.highlight.on = 1;
 }
 
 /** If we want to print a string. */
@@ -316,21 +332,26 @@ void StyleHighlightOn(const enum StylePunctuate p) {
 void StyleHighlightOff(void) {
 	assert(style.highlight.punctuate);
 	if(style.highlight.on)
-		fputs(style.highlight.punctuate->end, stdout), style.highlight.on = 0;
+		SinkPuts(style.highlight.punctuate->end), style.highlight.on = 0;
 	style.highlight.punctuate = 0;
 }
 
 /** Encode a bunch of arbitrary text `from` to `length` as whatever the options
  were.
- @param[is_buffer] Appends to the buffer chosen in `Buffer.c`. */
+ @param[is_buffer] Appends to the buffer chosen in `Buffer.c`.
+ @param[is_source] `from` outlives the sink, so runs that are not escaped can
+ be referenced instead of copied; see <fn:SinkReference>. */
 static void encode_len_choose(int length, const char *from,
-	const enum Format f, const int is_buffer) {
+	const enum Format f, const int is_buffer, const int is_source) {
+	void (*const run)(const char *const, const size_t)
+		= is_source ? &SinkReference : &SinkWrite;
 	int ahead = 0;
 	char *b;
 	const char *str;
 	size_t str_len;
-	assert(length >= 0 && from);
+	assert(length >= 0 && from && !(is_buffer && is_source));
 	
+	/* Runs of characters that don't need escaping are copied all at once. */
 	switch(f) {
 	case OUT_HTML:
 		if(is_buffer) goto html_encode_buffer;
@@ -350,6 +371,9 @@ raw_encode_buffer:
 	
 html_encode_buffer:
 	while(length - ahead) {
+		ahead += (int)EscapeSpan(ESCAPE_HTML, from + ahead,
+			(size_t)(length - ahead));
+		if(ahead == length) break;
 		switch(from[ahead]) {
 			case '<': str = HTML_LT, str_len = strlen(str); break;
 			case '>': str = HTML_GT, str_len = strlen(str); break;
@@ -378,6 +402,9 @@ terminate_html:
 md_encode_buffer:
 	while(length - ahead) {
 		const char *escape = 0;
+		ahead += (int)EscapeSpan(ESCAPE_MD, from + ahead,
+			(size_t)(length - ahead));
+		if(ahead == length) break;
 		switch(from[ahead]) {
 			case '\0': goto terminate_md;
 			case '\\': case '`': case '*': case '_': case '{': case '}': case '[':
@@ -410,55 +437,76 @@ terminate_md:
 	return;
 	
 raw_encode_print:
-	printf("%.*s", length, from);
+	/* As `printf("%.*s")`, which stops at null. */
+	str = memchr(from, '\0', (size_t)length);
+	run(from, str ? (size_t)(str - from) : (size_t)length);
 	return;
 	
 html_encode_print:
-	while(length) {
-		switch(*from) {
-			case '<': fputs(HTML_LT, stdout); break;
-			case '>': fputs(HTML_GT, stdout); break;
-			case '&': fputs(HTML_AMP, stdout); break;
-			case '\0': fprintf(stderr, "Encoded null with %d left.\n", length);
-				return;
-			default: fputc(*from, stdout); break;
+	while(length - ahead) {
+		ahead += (int)EscapeSpan(ESCAPE_HTML, from + ahead,
+			(size_t)(length - ahead));
+		if(ahead == length) break;
+		switch(from[ahead]) {
+			case '<': str = HTML_LT; break;
+			case '>': str = HTML_GT; break;
+			case '&': str = HTML_AMP; break;
+			case '\0': fprintf(CdocGetErr(), "Encoded null with %d left.\n",
+				length - ahead); length = ahead; goto terminate_html_print;
+			default: ahead++; continue;
 		}
-		from++, length--;
+		run(from, (size_t)ahead), SinkPuts(str);
+		from += ahead + 1, length -= ahead + 1, ahead = 0;
 	}
+terminate_html_print:
+	run(from, (size_t)ahead);
 	return;
 	
 md_encode_print:
-	while(length) {
-		switch(*from) {
-			case '\0': fprintf(stderr, "Encoded null with %d left.\n", length);
-				return;
+	while(length - ahead) {
+		ahead += (int)EscapeSpan(ESCAPE_MD, from + ahead,
+			(size_t)(length - ahead));
+		if(ahead == length) break;
+		switch(from[ahead]) {
+			case '\0': fprintf(CdocGetErr(), "Encoded null with %d left.\n",
+				length - ahead); length = ahead; goto terminate_md_print;
 			case '\\': case '`': case '*': case '_': case '{': case '}': case '[':
 			case ']': case '(': case ')': case '#': case '+': case '-': case '.':
-			case '!': printf("\\%c", *from); break;
-			default: fputc(*from, stdout); break;
+			case '!': break;
+			default: ahead++; continue;
 		}
-		from++, length--;
+		run(from, (size_t)ahead), SinkPutc('\\'), SinkPutc(from[ahead]);
+		from += ahead + 1, length -= ahead + 1, ahead = 0;
 	}
+terminate_md_print:
+	run(from, (size_t)ahead);
 	return;
 }
 
 static void encode_len(const int length, const char *const from) {
 	assert(length > 0);
-	encode_len_choose(length, from, effective_format(), 0);
+	encode_len_choose(length, from, effective_format(), 0, 0);
 }
 
-/** Encodes `from` with the `length` in the style chosen to `stdout`. */
+/** Encodes `from` with the `length` in the style chosen to the sink. */
 void StyleEncodeLength(const int length, const char *const from) {
 	if(!from || length <= 0) return;
 	encode_len(length, from);
 }
 
-/** Encodes `string` in the style chosen to `stdout`. */
+/** <fn:StyleEncodeLength>, but `from` is in a `Text` that is open until the
+ sink is flushed, so it need not be copied. */
+void StyleEncodeSource(const int length, const char *const from) {
+	if(!from || length <= 0) return;
+	encode_len_choose(length, from, effective_format(), 0, 1);
+}
+
+/** Encodes `string` in the style chosen to the sink. */
 void StyleEncode(const char *const string) {
 	size_t length;
 	if(!string) return;
 	length = strlen(string);
-	if(length > INT_MAX) { fprintf(stderr,
+	if(length > INT_MAX) { fprintf(CdocGetErr(),
 		"StyleEncode \"%.10s...\" length clipped at %d.\n", string, INT_MAX);
 		length = INT_MAX; }
 	encode_len((int)length, string);
@@ -469,7 +517,7 @@ void StyleEncode(const char *const string) {
 const char *StyleEncodeLengthCatToBuffer(const int length,
 	const char *const from) {
 	if(length <= 0 || !from) return BufferGet();
-	encode_len_choose(length, from, effective_format(), 1);
+	encode_len_choose(length, from, effective_format(), 1, 0);
 	return BufferGet();
 }
 	   
@@ -477,6 +525,6 @@ const char *StyleEncodeLengthCatToBuffer(const int length,
 const char *StyleEncodeLengthRawToBuffer(const int length,
 	const char *const from) {
 	BufferClear();
-	if(length > 0 && from) encode_len_choose(length, from, OUT_RAW, 1);
+	if(length > 0 && from) encode_len_choose(length, from, OUT_RAW, 1, 0);
 	return BufferGet();
 }
@@ -11,7 +11,9 @@ enum StylePunctuate { ST_NO_STYLE, ST_PLAIN, ST_PAREN, ST_LICENSE, ST_CSV,
 	ST_EM, ST_STRONG, ST_EM_HTML, ST_STRONG_HTML };
 
 enum Format StyleFormat(void);
+enum Format StyleDocumentFormat(void);
 void Style_(void);
+void Style(const enum Format format);
 void StylePush(const enum StylePunctuate);
 void StylePop(void);
 void StylePopStrong(void);
@@ -25,6 +27,7 @@ void StyleFlush(void);
 void StyleHighlightOn(const enum StylePunctuate);
 void StyleHighlightOff(void);
 void StyleEncodeLength(const int length, const char *const from);
+void StyleEncodeSource(const int length, const char *const from);
 void StyleEncode(const char *const str);
 const char *StyleEncodeLengthCatToBuffer(const int length,
 	const char *const from);
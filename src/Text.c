@@ -1,29 +1,104 @@
 /** @license 2019 Neil Edelman, distributed under the terms of the MIT License;
  see readme.txt, or \url{ https://opensource.org/licenses/MIT }.
 
- Handles reading entire files and keeping them in memory.
+ Handles reading entire files and keeping them in memory. Where `mmap` is
+ available, and the file does not end exactly on a page boundary, the file is
+ mapped privately, and the terminating `'\0'` that the scanner expects is
+ written after the contents, in the tail of the last page. That copies only
+ the last page; if the file grows after it's mapped, the `'\0'` is still
+ there. Otherwise, regular files are read in one piece and streams are read
+ in chunks. Define `TEXT_NO_MMAP` to always read. Texts are shared between
+ threads, so the lines are indexed when it's opened, and after that it doesn't
+ change. Open texts are in a hash table of their names; a text is claimed in
+ the table under the lock, but it's read outside of it, so that threads don't
+ wait on each other's files, only on the same one. An input is used by the
+ thread that documents it, and closed when it's released, but a text that is
+ opened, such as a header, is kept for the others until it's closed.
 
- @std C89 */
+ @std C89, POSIX.1-2001 `mmap` `pthread` */
 
-#include <stdio.h>  /* FILE fopen fclose fread */
-#include <string.h> /* memcpy strrchr strlen */
+#if defined(__unix__) || defined(__APPLE__)
+#define TEXT_LOCK
+#define TEXT_STAT
+#ifndef TEXT_NO_MMAP
+#define TEXT_MMAP
+#endif
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L /* fileno fstat mmap sysconf pthread */
+#endif
+#endif
+
+#include <stdio.h>  /* FILE fopen fclose fread fseek ftell */
+#include <string.h> /* memcpy memchr strrchr strlen strcmp */
 #include <stdlib.h> /* malloc free */
 #include <assert.h> /* assert */
 #include <errno.h>  /* errno EILSEQ */
+#include <time.h>   /* time */
+#ifdef TEXT_STAT /* <-- stat */
+#include <sys/types.h> /* off_t */
+#include <sys/stat.h>  /* fstat S_ISREG */
+#endif /* stat --> */
+#ifdef TEXT_MMAP /* <-- mmap */
+#include <sys/mman.h>  /* mmap munmap */
+#include <unistd.h>    /* sysconf */
+#endif /* mmap --> */
+#ifdef TEXT_LOCK /* <-- lock */
+#include <pthread.h> /* pthread_mutex */
+#endif /* lock --> */
 #include "Path.h" /* `path_dirsep` */
-#include "Text.h"
+#include "Text.h" /** \include */
 
 /* Define `CharArray`, a vector of characters. */
 #define ARRAY_NAME Char
 #define ARRAY_TYPE char
 #include "Array.h"
 
-struct Text { struct CharArray buffer; char *filename, *basename; };
+/* Define `SizeArray`, a vector of offsets. */
+#define ARRAY_NAME Size
+#define ARRAY_TYPE size_t
+#include "Array.h"
+
+/* `contents` is either `buffer` or `map`. `size` includes the `'\0'`.
+ `lines` are the offsets of the start of every line after the first. `mtime`
+ is the modification time from before it was read, or -1. In the table of
+ open files, `next` has the same bucket of `hash`, and other threads that want
+ it while it's `TEXT_LOADING` are `waiters`; if it's `TEXT_FAILED`, `error` is
+ what `errno` was. `uses` are the threads that are documenting it, and
+ `is_kept` if it stays open after them. */
+struct Text {
+	struct Text *next;
+	unsigned long hash;
+	enum { TEXT_LOADING, TEXT_READY, TEXT_FAILED } state;
+	int error;
+	unsigned waiters, uses;
+	int is_kept;
+	struct CharArray buffer;
+	struct SizeArray lines;
+	void *map;
+	size_t map_size;
+	const char *contents;
+	size_t size;
+	long mtime;
+	char *filename, *basename;
+};
 
 /** Zeros `file`. */
 static void zero_buffer(struct Text *const b) {
 	assert(b);
+	b->next = 0;
+	b->hash = 0;
+	b->state = TEXT_LOADING;
+	b->error = 0;
+	b->waiters = 0;
+	b->uses = 0;
+	b->is_kept = 0;
 	CharArray(&b->buffer);
+	SizeArray(&b->lines);
+	b->map = 0;
+	b->map_size = 0;
+	b->contents = 0;
+	b->size = 0;
+	b->mtime = -1;
 	b->filename = 0;
 	b->basename = 0;
 }
@@ -32,51 +107,145 @@ static void zero_buffer(struct Text *const b) {
 static void Text_(struct Text **const pb) {
 	struct Text *b;
 	if(!pb || !(b = *pb)) return;
+#ifdef TEXT_MMAP /* <-- mmap */
+	if(b->map) munmap(b->map, b->map_size);
+#endif /* mmap --> */
 	CharArray_(&b->buffer);
+	SizeArray_(&b->lines);
 	free(b);
 	*pb = 0;
 }
 
-/** Opens the file as text and ensures that the file contents has no zeros, but
- doesn't do any checks otherwise.
- @return Reads `fn` to memory as a `Text` or null is error.
- @throws[malloc, fread]
- @throws[EILSEQ] If the file has embedded zeros. */
-static struct Text *Text(const char *const fn) {
-	FILE *fp = 0;
-	struct Text *t = 0;
+#ifdef TEXT_MMAP /* <-- mmap */
+/** Tries to map `fp` to `t` such that there is a zero after the contents,
+ which is our own.
+ @return Success; if false, the file should be read instead. */
+static int map_text(struct Text *const t, FILE *const fp) {
+	struct stat st;
+	long page;
+	size_t size;
+	void *map;
+	assert(t && fp && !t->map);
+	if(fstat(fileno(fp), &st) == -1) return 0;
+	/* Streams, empty files, files that are too large to address, and files
+	 that fill their last page exactly (no free zero) get read. */
+	if(!S_ISREG(st.st_mode) || st.st_size <= 0
+		|| (page = sysconf(_SC_PAGESIZE)) <= 0
+		|| (off_t)(size = (size_t)st.st_size) != st.st_size
+		|| !(size % (size_t)page)) return 0;
+	if((map = mmap(0, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fileno(fp),
+		0)) == MAP_FAILED) return 0;
+	/* The zero-fill is shared with the file until it's written. */
+	((char *)map)[size] = '\0';
+	t->map = map;
+	t->map_size = size;
+	t->contents = map;
+	t->size = size + 1;
+	return 1;
+}
+#endif /* mmap --> */
+
+/** Reads `fp` to `t`, exactly sized if it is seekable.
+ @return Success.
+ @throws[malloc, fread] */
+static int read_text(struct Text *const t, FILE *const fp) {
 	const size_t granularity = 1024;
-	size_t nread, zero_len, file_size, fn_size;
-	char *read_here, *terminating, *buffer, *base;
-	if(!fn || !(fp = fopen(fn, "r"))) goto catch;
-	fn_size = strlen(fn) + 1;
-	if(!(t = malloc(sizeof *t + fn_size))) goto catch;
-	zero_buffer(t);
-	t->filename = (char *)(t + 1);
-	memcpy(t->filename, fn, fn_size);
-	t->basename = (base = strrchr(t->filename, *path_dirsep))
-		? base + 1 : t->filename;
-	/* Read all contents at once and close the file; now in memory. */
-	do {
+	size_t nread, expect = 0;
+	long end;
+	char *read_here, *terminating;
+	assert(t && fp && !t->map);
+	/* Find the size; streams have to be read in chunks. */
+	if(!fseek(fp, 0l, SEEK_END) && (end = ftell(fp)) > 0
+		&& !fseek(fp, 0l, SEEK_SET)) expect = (size_t)end;
+	if(expect) {
+		if(!(read_here = CharArrayReserve(&t->buffer, expect + 1))
+			|| (nread = fread(read_here, 1, expect, fp), ferror(fp))
+			|| (nread && !CharArrayBuffer(&t->buffer, nread))) return 0;
+	}
+	/* Stream, or the file grew underneath us. */
+	if(!expect || nread == expect) do {
 		if(!(read_here = CharArrayReserve(&t->buffer, granularity))
 			|| (nread = fread(read_here, 1, granularity, fp), ferror(fp))
-			|| !CharArrayBuffer(&t->buffer, nread)) goto catch;
+			|| (nread && !CharArrayBuffer(&t->buffer, nread))) return 0;
 	} while(nread == granularity);
-	fclose(fp), fp = 0;
 	/* Embed '\0' on the end for simple lexing. */
-	if(!(terminating = CharArrayNew(&t->buffer))) goto catch;
+	if(!(terminating = CharArrayNew(&t->buffer))) return 0;
 	*terminating = '\0';
-	/* The file can have no embedded '\0'. */
-	buffer = CharArrayGet(&t->buffer);
-	zero_len = (size_t)(strchr(buffer, '\0') - buffer);
-	file_size = CharArraySize(&t->buffer);
-	assert(file_size > 0);
-	if(zero_len != file_size - 1) { errno = EILSEQ; goto catch; }
+	t->contents = CharArrayGet(&t->buffer);
+	t->size = CharArraySize(&t->buffer);
+	return 1;
+}
+
+/** Indexes the lines of `text`. Newlines are `\n`, `\r\n`, or `\r`;
+ `memchr` is vectorised for the usual case where there are only `\n`.
+ @return Success. @throws[realloc] */
+static int index_lines(struct Text *const text) {
+	const char *const begin = text->contents, *const end
+		= text->contents + text->size - 1, *s = begin;
+	size_t *line;
+	assert(text && text->contents && text->size);
+	if(memchr(begin, '\r', text->size - 1)) {
+		for( ; s < end; s++) {
+			if(*s != '\n' && (*s != '\r' || s[1] == '\n')) continue;
+			if(!(line = SizeArrayNew(&text->lines))) return 0;
+			*line = (size_t)(s + 1 - begin);
+		}
+	} else {
+		while((s = memchr(s, '\n', (size_t)(end - s)))) {
+			if(!(line = SizeArrayNew(&text->lines))) return 0;
+			*line = (size_t)(++s - begin);
+		}
+	}
+	return 1;
+}
+
+/** @return A new text that is named `fn` with `hash`, but not read, or null.
+ @throws[malloc] */
+static struct Text *Text(const char *const fn, const unsigned long hash) {
+	const size_t fn_size = strlen(fn) + 1;
+	struct Text *t;
+	char *base;
+	assert(fn);
+	if(!(t = malloc(sizeof *t + fn_size))) return 0;
+	zero_buffer(t);
+	t->hash = hash;
+	t->filename = (char *)(t + 1);
+	memcpy(t->filename, fn, fn_size);
+	t->basename = (base = strrchr(t->filename, *path_dirsep))
+		? base + 1 : t->filename;
 	return t;
-catch:
-	if(fp) fclose(fp);
-	Text_(&t);
-	return 0;
+}
+
+/** Reads the file of `t` and ensures that the file contents has no zeros,
+ but doesn't do any checks otherwise.
+ @return Success. @throws[fopen, malloc, realloc, fread, fstat]
+ @throws[EILSEQ] If the file has embedded zeros. */
+static int read_file(struct Text *const t) {
+	FILE *fp;
+	int success = 0;
+	assert(t && t->filename && !t->contents);
+	if(!(fp = fopen(t->filename, "r"))) return 0;
+#ifdef TEXT_STAT /* <-- stat */
+	{ /* Before it's read; it could change in the second that it was. */
+		struct stat st;
+		if(fstat(fileno(fp), &st) != -1 && S_ISREG(st.st_mode)
+			&& (long)st.st_mtime < (long)time(0) - 1)
+			t->mtime = (long)st.st_mtime;
+	}
+#endif /* stat --> */
+	/* All contents are in memory after closing the file. */
+#ifdef TEXT_MMAP /* <-- mmap */
+	if(!map_text(t, fp))
+#endif /* mmap --> */
+	if(!read_text(t, fp)) goto finally;
+	/* The file can have no embedded '\0'. */
+	assert(t->contents && t->size > 0);
+	if(memchr(t->contents, '\0', t->size - 1)) { errno = EILSEQ; goto finally; }
+	if(!index_lines(t)) goto finally;
+	success = 1;
+finally:
+	fclose(fp);
+	return success;
 }
 
 /** @return The file name of `file`. */
@@ -91,33 +260,230 @@ const char *TextBaseName(const struct Text *const b) {
 
 /** @return The length of the contents of `file`. */
 size_t TextSize(const struct Text *const b) {
-	return b ? CharArraySize(&b->buffer) : 0;
+	return b ? b->size : 0;
+}
+
+/** @return The modification time of `file` from before it was read, or -1 if
+ it's not known, or it could have been modified in the same second. */
+long TextTime(const struct Text *const b) {
+	return b ? b->mtime : -1;
 }
 
 /** @return The contents of `file`. */
 const char *TextGet(const struct Text *const b) {
-	return b ? CharArrayGet(&b->buffer) : 0;
+	return b ? b->contents : 0;
+}
+
+/** @param[p] A pointer into the contents of `file`.
+ @return The line number of `p` in `file`, starting at one, or zero if `p` is
+ not in `file`.
+ @order \O(\log `lines`) */
+size_t TextLine(const struct Text *const b, const char *const p) {
+	const size_t *lines;
+	size_t offset, lo = 0, hi;
+	if(!b || !p || p < b->contents || p > b->contents + b->size) return 0;
+	offset = (size_t)(p - b->contents);
+	lines = SizeArrayGet(&b->lines);
+	hi = SizeArraySize(&b->lines);
+	/* The number of lines that start at or before `offset`. */
+	while(lo < hi) {
+		const size_t mid = lo + (hi - lo) / 2;
+		if(lines[mid] <= offset) lo = mid + 1; else hi = mid;
+	}
+	return lo + 1;
 }
 
 #define ARRAY_NAME Text
 #define ARRAY_TYPE struct Text *
 #include "Array.h"
 
-static struct TextArray files;
-static struct CharArray temp;
+/* The open texts are chained in `buckets`, which is a power of two that is
+ more than `size`. */
+static struct {
+	struct TextArray buckets;
+	size_t size;
+} files;
+#ifdef TEXT_LOCK /* <-- lock */
+static pthread_mutex_t files_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t files_loaded = PTHREAD_COND_INITIALIZER;
+#endif /* lock --> */
+
+/** @return The 32-bit FNV-1a hash of `s`. */
+static unsigned long fnv(const char *s) {
+	unsigned long h = 0x811c9dc5UL;
+	while(*s) h = ((h ^ (unsigned char)*s++) * 0x01000193UL) & 0xffffffffUL;
+	return h;
+}
+
+/** @return The link in `files` that has `fn` with `hash`, or the null link at
+ the end of it's bucket. There must be buckets. */
+static struct Text **files_link(const char *const fn,
+	const unsigned long hash) {
+	struct Text **link;
+	assert(fn && TextArraySize(&files.buckets));
+	for(link = TextArrayGet(&files.buckets)
+		+ (hash & (TextArraySize(&files.buckets) - 1)); *link;
+		link = &(*link)->next)
+		if((*link)->hash == hash && !strcmp((*link)->filename, fn)) break;
+	return link;
+}
+
+/** Makes sure there is room for one more in `files`.
+ @return Success. @throws[realloc] */
+static int files_reserve(void) {
+	struct TextArray grown;
+	struct Text **from, **to, *t, *next;
+	const size_t no = TextArraySize(&files.buckets);
+	size_t i, mask;
+	if(files.size < no) return 1;
+	TextArray(&grown);
+	if(!(to = TextArrayBuffer(&grown, no ? no << 1 : 64))) return 0;
+	mask = TextArraySize(&grown) - 1;
+	for(i = 0; i <= mask; i++) to[i] = 0;
+	for(from = TextArrayGet(&files.buckets), i = 0; i < no; i++)
+		for(t = from[i]; t; t = next) {
+			struct Text **const bucket = to + (t->hash & mask);
+			next = t->next, t->next = *bucket, *bucket = t;
+		}
+	TextArray_(&files.buckets);
+	files.buckets = grown;
+	return 1;
+}
+
+/** Takes `t` out of `files`. */
+static void files_remove(struct Text *const t) {
+	struct Text **const link = files_link(t->filename, t->hash);
+	assert(*link == t);
+	*link = t->next, t->next = 0;
+	files.size--;
+}
+
+/** Loads `fn` into memory, or gets it if it's open; if another thread is
+ reading the same file, waits for it. Either it `is_use`, or it's kept.
+ @return The text or null. @throws[fopen, malloc, realloc, fread, fstat]
+ @throws[EILSEQ] If the file has embedded zeros. */
+static struct Text *open_text(const char *const fn, const int is_use) {
+	struct Text **link, *text = 0;
+	unsigned long hash;
+	int is_reader = 0, success, e;
+	if(!fn) return 0;
+	hash = fnv(fn);
+#ifdef TEXT_LOCK
+	pthread_mutex_lock(&files_lock);
+#endif
+	if(!files_reserve()) goto unlock;
+	if(!(text = *(link = files_link(fn, hash)))) {
+		/* It's ours to read. */
+		if(!(text = *link = Text(fn, hash))) goto unlock;
+		files.size++, is_reader = 1;
+	}
+	if(is_use) text->uses++;
+	else text->is_kept = 1;
+	if(is_reader) goto unlock;
+#ifdef TEXT_LOCK
+	text->waiters++;
+	while(text->state == TEXT_LOADING)
+		pthread_cond_wait(&files_loaded, &files_lock);
+	text->waiters--;
+#endif
+	if(text->state == TEXT_FAILED) {
+		/* It's out of `files` already; the last one frees it. */
+		errno = text->error;
+		if(!text->waiters) Text_(&text);
+		text = 0;
+	}
+unlock:
+#ifdef TEXT_LOCK
+	pthread_mutex_unlock(&files_lock);
+#endif
+	if(!is_reader) return text;
+	/* Outside of the lock, so different files are read at the same time. */
+	success = read_file(text), e = errno;
+#ifdef TEXT_LOCK
+	pthread_mutex_lock(&files_lock);
+#endif
+	if(success) {
+		text->state = TEXT_READY;
+	} else {
+		text->state = TEXT_FAILED, text->error = e;
+		files_remove(text);
+		if(!text->waiters) Text_(&text);
+		text = 0;
+	}
+#ifdef TEXT_LOCK
+	pthread_cond_broadcast(&files_loaded);
+	pthread_mutex_unlock(&files_lock);
+#endif
+	errno = e;
+	return text;
+}
+
+/** Loads new `Text` from `fn` into memory, or gets it if it's open. A file
+ that is opened, say, a header that many files include, is kept open and
+ shared instead of read again; this assumes it doesn't change in that time,
+ (see <fn:TextClose>.) Any thread can call this.
+ @return The text or null. @throws[fopen, malloc, realloc, fread, fstat]
+ @throws[EILSEQ] If the file has embedded zeros.
+ @order \O(1) average, and the size of the file the first time */
+struct Text *TextOpen(const char *const fn) { return open_text(fn, 0); }
+
+/** Loads `fn` like <fn:TextOpen>, but it's only in use until
+ <fn:TextRelease>, unless it's opened in that time.
+ @return The text or null. @throws[fopen, malloc, realloc, fread, fstat]
+ @throws[EILSEQ] If the file has embedded zeros. */
+struct Text *TextUse(const char *const fn) { return open_text(fn, 1); }
+
+/** Releases the `text` from <fn:TextUse>; when nothing is using it, and it
+ wasn't opened, it's unloaded. Any thread can call this.
+ @param[text] If null, does nothing. */
+void TextRelease(struct Text *text) {
+	if(!text) return;
+#ifdef TEXT_LOCK
+	pthread_mutex_lock(&files_lock);
+#endif
+	assert(text->state == TEXT_READY && text->uses);
+	if(!--text->uses && !text->is_kept) files_remove(text), Text_(&text);
+#ifdef TEXT_LOCK
+	pthread_mutex_unlock(&files_lock);
+#endif
+}
+
+/** Any thread can call this. @return The text of `fn` if it's open, or null;
+ it isn't read if it's not. */
+struct Text *TextFind(const char *const fn) {
+	struct Text *text = 0;
+	assert(fn);
+#ifdef TEXT_LOCK
+	pthread_mutex_lock(&files_lock);
+#endif
+	if(TextArraySize(&files.buckets) && (text = *files_link(fn, fnv(fn)))
+		&& text->state != TEXT_READY) text = 0;
+#ifdef TEXT_LOCK
+	pthread_mutex_unlock(&files_lock);
+#endif
+	return text;
+}
 
-/** Loads new `Text` from `fn` into memory. */
-struct Text *TextOpen(const char *const fn) {
-	struct Text **ptext = TextArrayNew(&files);
-	if(!ptext) return 0;
-	if(!(*ptext = Text(fn))) { TextArrayPop(&files); return 0; }
-	return *ptext;
+/** Unloads the text of `fn`, if it's open, so that it's read again the next
+ time it's opened. Nothing can be using it. */
+void TextClose(const char *const fn) {
+	struct Text *text;
+	assert(fn);
+#ifdef TEXT_LOCK
+	pthread_mutex_lock(&files_lock);
+#endif
+	if(TextArraySize(&files.buckets) && (text = *files_link(fn, fnv(fn)))
+		&& text->state == TEXT_READY) files_remove(text), Text_(&text);
+#ifdef TEXT_LOCK
+	pthread_mutex_unlock(&files_lock);
+#endif
 }
 
-/** Unloads all texts. */
+/** Unloads all texts. Nothing can be using them. */
 void TextCloseAll(void) {
-	struct Text **ptext;
-	while((ptext = TextArrayPop(&files))) Text_(ptext);
-	CharArray_(&temp);
-	TextArray_(&files);
+	struct Text **bucket = 0, *text;
+	while((bucket = TextArrayNext(&files.buckets, bucket)))
+		while((text = *bucket)) *bucket = text->next, Text_(&text);
+	TextArray_(&files.buckets);
+	files.size = 0;
 }
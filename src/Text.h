@@ -3,6 +3,12 @@ struct Text;
 const char *TextName(const struct Text *const file);
 const char *TextBaseName(const struct Text *const file);
 size_t TextSize(const struct Text *const file);
+long TextTime(const struct Text *const file);
 const char *TextGet(const struct Text *const file);
+size_t TextLine(const struct Text *const file, const char *const p);
 struct Text *TextOpen(const char *const fn);
+struct Text *TextUse(const char *const fn);
+void TextRelease(struct Text *text);
+struct Text *TextFind(const char *const fn);
+void TextClose(const char *const fn);
 void TextCloseAll(void);
@@ -0,0 +1,12 @@
+/* `THREAD_LOCAL` storage is separate for every thread, and then
+ `THREAD_LOCAL_SEPARATE` is defined. If the compiler has no way to say it, it's
+ ordinary storage, and there can be only one thread. */
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define THREAD_LOCAL _Thread_local
+#define THREAD_LOCAL_SEPARATE
+#elif defined(__GNUC__)
+#define THREAD_LOCAL __thread
+#define THREAD_LOCAL_SEPARATE
+#else
+#define THREAD_LOCAL
+#endif
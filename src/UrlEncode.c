@@ -89,7 +89,8 @@
 #include <ctype.h>  /* isalnum */
 #include <string.h> /* strchr */
 #include <errno.h>  /* errno ERANGE */
-#include "UrlEncode.h"
+#include "ThreadLocal.h"
+#include "UrlEncode.h" /** \include */
 
 /* rfc1738:
  
@@ -107,11 +108,11 @@
 static char hexchars[] = "0123456789ABCDEF";
 
 /** URL encode the substring `s` with `length` to a static string of fixed
- maximum length.
+ maximum length, one for each thread.
  @throws[ERANGE] The string could not be encoded in this length.
  @return A static string or null. */
 const char *UrlEncode(char const *const s, size_t length) {
-	static char encoded[64];
+	static THREAD_LOCAL char encoded[64];
 	unsigned char c;
 	char *to = encoded;
 	char const *from = s, *const end = from + length;
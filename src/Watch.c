@@ -0,0 +1,189 @@
+/** @license 2019 Neil Edelman, distributed under the terms of the
+ [MIT License](https://opensource.org/licenses/MIT).
+
+ Waits for files to change with Linux `inotify`. Editors often save by
+ writing another file and renaming it over, so the directory of every file is
+ watched instead of the file, for files that are finished being written or
+ moved in. The names that changed are spelled the same way that they were
+ added. There is no delay after an event; whatever else is already there
+ comes with it. If the events overflow, they all have changed.
+
+ @std C89, Linux `inotify`, POSIX.1-2001 `poll` `read` */
+
+#ifdef __linux__
+#define WATCH_INOTIFY
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 200112L /* poll read close */
+#endif
+#endif
+
+#include <stddef.h> /* size_t */
+#include <stdlib.h> /* malloc free */
+#include <string.h> /* strlen strrchr strcmp strncmp memcpy */
+#include <assert.h> /* assert */
+#include <errno.h>  /* errno EINTR EDOM */
+#ifdef WATCH_INOTIFY /* <-- inotify */
+#include <sys/types.h>   /* ssize_t */
+#include <sys/inotify.h> /* inotify_init inotify_add_watch inotify_event */
+#include <unistd.h>      /* read close */
+#include <poll.h>        /* poll */
+#endif /* inotify --> */
+#include "Path.h" /* `path_dirsep` */
+#include "Watch.h" /** \include */
+
+#define ARRAY_NAME Char
+#define ARRAY_TYPE char
+#include "Array.h"
+
+#define ARRAY_NAME Size
+#define ARRAY_TYPE size_t
+#include "Array.h"
+
+/** A directory is watched as `wd`; the files in it are named after `prefix`,
+ which is the same directory as it was spelled. */
+struct Dir { int wd; char *prefix; };
+
+#define ARRAY_NAME Dir
+#define ARRAY_TYPE struct Dir
+#include "Array.h"
+
+/* If `is_open`, `dirs` are watched on `fd`. The names that changed are
+ null-terminated in `names`, starting at `offsets`. */
+static struct {
+	int is_open, fd;
+	struct DirArray dirs;
+	struct CharArray names;
+	struct SizeArray offsets;
+} watch;
+
+/** Stops watching. */
+void Watch_(void) {
+	struct Dir *d = 0;
+	while((d = DirArrayNext(&watch.dirs, d))) free(d->prefix);
+	DirArray_(&watch.dirs);
+	CharArray_(&watch.names);
+	SizeArray_(&watch.offsets);
+#ifdef WATCH_INOTIFY
+	if(watch.is_open) close(watch.fd), watch.is_open = 0;
+#endif
+}
+
+/** @return The number of files that changed. */
+size_t WatchSize(void) {
+	return SizeArraySize(&watch.offsets);
+}
+
+/** @return The name of file `i` that changed, which is less then
+ <fn:WatchSize>. */
+const char *WatchGet(const size_t i) {
+	assert(i < WatchSize());
+	return CharArrayGet(&watch.names) + SizeArrayGet(&watch.offsets)[i];
+}
+
+#ifdef WATCH_INOTIFY /* <-- inotify */
+
+/** Starts watching, with nothing. @return Success. @throws[inotify_init] */
+int Watch(void) {
+	Watch_();
+	return watch.is_open = (watch.fd = inotify_init()) != -1;
+}
+
+/** Watches for changes to `fn`. Files that are in a directory that doesn't
+ exist are not watched.
+ @return Success. @throws[malloc, realloc, inotify_add_watch] */
+int WatchAdd(const char *const fn) {
+	const char *const sep = strrchr(fn, *path_dirsep);
+	const size_t prefix_len = sep ? (size_t)(sep + 1 - fn) : 0;
+	struct Dir *d = 0;
+	char *prefix;
+	int wd;
+	assert(watch.is_open && fn);
+	while((d = DirArrayNext(&watch.dirs, d))) if(!strncmp(d->prefix, fn,
+		prefix_len) && d->prefix[prefix_len] == '\0') return 1;
+	if(!(prefix = malloc(prefix_len + 1))) return 0;
+	memcpy(prefix, fn, prefix_len), prefix[prefix_len] = '\0';
+	if((wd = inotify_add_watch(watch.fd, prefix_len ? prefix : ".",
+		IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR)) == -1) {
+		free(prefix);
+		if(errno != ENOENT && errno != ENOTDIR) return 0;
+		errno = 0;
+		return 1;
+	}
+	if(!(d = DirArrayNew(&watch.dirs))) { free(prefix); return 0; }
+	d->wd = wd, d->prefix = prefix;
+	return 1;
+}
+
+/** Adds `name` in `prefix` to the names that changed, if it's not there.
+ @return Success. @throws[realloc] */
+static int changed(const char *const prefix, const char *const name) {
+	const size_t prefix_len = strlen(prefix), name_len = strlen(name);
+	size_t i, *offset;
+	char *c;
+	for(i = 0; i < WatchSize(); i++) if(!strncmp(WatchGet(i), prefix,
+		prefix_len) && !strcmp(WatchGet(i) + prefix_len, name)) return 1;
+	if(!(offset = SizeArrayNew(&watch.offsets))) return 0;
+	*offset = CharArraySize(&watch.names);
+	if(!(c = CharArrayBuffer(&watch.names, prefix_len + name_len + 1)))
+		{ SizeArrayPop(&watch.offsets); return 0; }
+	memcpy(c, prefix, prefix_len), memcpy(c + prefix_len, name, name_len + 1);
+	return 1;
+}
+
+/** Forgets the directory `wd`, which is gone; it may be back by next time. */
+static void forget(const int wd) {
+	size_t i = 0;
+	while(i < DirArraySize(&watch.dirs)) {
+		struct Dir *const d = DirArrayGet(&watch.dirs) + i;
+		if(d->wd != wd) { i++; continue; }
+		free(d->prefix);
+		DirArrayRemove(&watch.dirs, d);
+	}
+}
+
+/** Blocks until at least one watched directory has a change, and takes all
+ the events that are waiting.
+ @param[is_all] Set if events were lost, and anything could have changed.
+ @return Success; the files are in <fn:WatchGet>, (not all of them were
+ necessarily added.) @throws[read, poll, realloc] */
+int WatchWait(int *const is_all) {
+	union { struct inotify_event event; char buffer[4096]; } events;
+	struct pollfd p;
+	assert(watch.is_open && is_all);
+	*is_all = 0;
+	CharArrayClear(&watch.names);
+	SizeArrayClear(&watch.offsets);
+	p.fd = watch.fd, p.events = POLLIN;
+	for( ; ; ) {
+		const char *e, *end;
+		const ssize_t r = read(watch.fd, events.buffer, sizeof events.buffer);
+		if(r == -1) { if(errno == EINTR) continue; return 0; }
+		for(e = events.buffer, end = e + r; e < end;
+			e += sizeof events.event + ((const struct inotify_event *)
+			(const void *)e)->len) {
+			const struct inotify_event *const ev
+				= (const struct inotify_event *)(const void *)e;
+			struct Dir *d = 0;
+			if(ev->mask & IN_Q_OVERFLOW) { *is_all = 1; continue; }
+			if(ev->mask & IN_IGNORED) { forget(ev->wd); continue; }
+			if(ev->len) while((d = DirArrayNext(&watch.dirs, d)))
+				if(d->wd == ev->wd && !changed(d->prefix, ev->name)) return 0;
+		}
+		p.revents = 0;
+		if(poll(&p, 1, 0) != 1 || !(p.revents & POLLIN)) break;
+	}
+	return 1;
+}
+
+#else /* inotify --><-- !inotify */
+
+/** Without `inotify`, can't watch. @return False. @throws[EDOM] */
+int Watch(void) { errno = EDOM; return 0; }
+
+/** Without `inotify`, can't watch. @return False. @throws[EDOM] */
+int WatchAdd(const char *const fn) { (void)fn; errno = EDOM; return 0; }
+
+/** Without `inotify`, can't watch. @return False. @throws[EDOM] */
+int WatchWait(int *const is_all) { (void)is_all; errno = EDOM; return 0; }
+
+#endif /* !inotify --> */
@@ -0,0 +1,6 @@
+void Watch_(void);
+int Watch(void);
+int WatchAdd(const char *const fn);
+int WatchWait(int *const is_all);
+size_t WatchSize(void);
+const char *WatchGet(const size_t i);
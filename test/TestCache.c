@@ -0,0 +1,116 @@
+#include <stdlib.h> /* EXIT malloc free system */
+#include <stdio.h>  /* printf fprintf fopen fread sprintf remove perror */
+#include <string.h> /* strlen strstr memcmp */
+#include <time.h>   /* time */
+
+/* These are in the working directory. */
+static const char *const in_fn = "TestCacheIn.c", *const cache_dir
+	= "TestCache.cache", *const out_fn = "TestCacheOut", *const err_fn
+	= "TestCacheErr";
+
+/** Reads `fn` into `text`. @return Success. */
+static int read_file(const char *const fn, char **const text,
+	size_t *const size) {
+	FILE *fp;
+	long len;
+	int success = 0;
+	if(!(fp = fopen(fn, "rb"))) return 0;
+	if(fseek(fp, 0, SEEK_END) || (len = ftell(fp)) < 0
+		|| fseek(fp, 0, SEEK_SET)) goto finally;
+	if(!(*text = malloc((size_t)len + 1))) goto finally;
+	if(fread(*text, 1, (size_t)len, fp) != (size_t)len) goto finally;
+	(*text)[len] = '\0';
+	*size = (size_t)len;
+	success = 1;
+finally:
+	fclose(fp);
+	return success;
+}
+
+/* What one run of `cdoc` wrote. */
+struct Run { char *out, *err; size_t out_size, err_size; };
+
+/** Documents the input in `format` with `cdoc`, `options`, and the cache,
+ into `run`; `format` and `options` must be short. @return Success. */
+static int run(const char *const cdoc, const char *const format,
+	const char *const options, struct Run *const run) {
+	char command[1024];
+	run->out = run->err = 0;
+	if(strlen(cdoc) > 512) return fprintf(stderr, "%s: too long.\n", cdoc), 0;
+	sprintf(command, "%.512s %.32s -f %.8s -c %s -o %s %s 2> %s", cdoc,
+		options, format, cache_dir, out_fn, in_fn, err_fn);
+	if(system(command)) { fprintf(stderr, "%s: failed.\n", command);
+		return 0; }
+	return read_file(out_fn, &run->out, &run->out_size)
+		&& read_file(err_fn, &run->err, &run->err_size);
+}
+
+/** Parses the input in `format` with and without the cache and checks that
+ the output and diagnostics are the same. @return Success. */
+static int test(const char *const cdoc, const char *const format) {
+	struct Run miss, hit, debug;
+	FILE *fp;
+	int success = 0;
+	miss.out = miss.err = hit.out = hit.err = debug.out = debug.err = 0;
+	if(!(fp = fopen(in_fn, "w"))) return perror(in_fn), 0;
+	/* An input that has a warning; the stamp makes the first run a miss. */
+	fprintf(fp, "/** Test of the cache, %s %lu. */\n\n"
+		"/** Does nothing with `y`. @return Zero. */\n"
+		"int foo(int x, int y) { return 0; }\n", format,
+		(unsigned long)time(0));
+	if(fclose(fp)) return perror(in_fn), 0;
+	if(!run(cdoc, format, "", &miss) || !run(cdoc, format, "", &hit)
+		|| !run(cdoc, format, "-d output", &debug)) goto finally;
+	if(!strstr(debug.err, "parsed from the cache")) {
+		fprintf(stderr, "%s: not parsed from the cache.\n", format);
+		goto finally;
+	}
+	if(!strstr(miss.err, "parameter may be undocumented")) {
+		fprintf(stderr, "%s: no warning: \"%s\".\n", format, miss.err);
+		goto finally;
+	}
+	if(miss.out_size != hit.out_size
+		|| memcmp(miss.out, hit.out, miss.out_size)) {
+		fprintf(stderr, "%s: output is not the same.\n", format);
+		goto finally;
+	}
+	if(miss.err_size != hit.err_size
+		|| memcmp(miss.err, hit.err, miss.err_size)) {
+		fprintf(stderr, "%s: \"%s\" is not \"%s\".\n", format, hit.err,
+			miss.err);
+		goto finally;
+	}
+	printf("%s: okay.\n", format);
+	success = 1;
+finally:
+	free(miss.out), free(miss.err), free(hit.out), free(hit.err);
+	free(debug.out), free(debug.err);
+	return success;
+}
+
+/** Removes the cache of the input, which is named like `Cache.c` does, by
+ the hash of the name and the flags, and then the directory, which should be
+ empty. @return Success. */
+static int remove_cache(void) {
+	const unsigned char flags[4] = { 0, 0, 0, 0 };
+	unsigned long h = 0x811c9dc5UL;
+	char fn[64];
+	size_t i;
+	for(i = 0; i <= strlen(in_fn); i++)
+		h = ((h ^ (unsigned char)in_fn[i]) * 0x01000193UL) & 0xffffffffUL;
+	for(i = 0; i < sizeof flags; i++)
+		h = ((h ^ flags[i]) * 0x01000193UL) & 0xffffffffUL;
+	sprintf(fn, "%.32s/%08lx.cdoc", cache_dir, h);
+	return !remove(fn) && !remove(cache_dir);
+}
+
+/** Tests that the second run of `cdoc`, which is from the cache, is
+ byte-for-byte the same as the first.
+ @param[argv] Optionally, the `cdoc` to run; otherwise, `bin/cdoc`. */
+int main(int argc, char **argv) {
+	const char *const cdoc = argc > 1 ? argv[1] : "bin/cdoc";
+	int success = test(cdoc, "md") && test(cdoc, "html");
+	remove(in_fn), remove(out_fn), remove(err_fn);
+	if(!remove_cache() && success) perror(cache_dir), success = 0;
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,79 @@
+#include <stdlib.h> /* EXIT malloc free system */
+#include <stdio.h>  /* printf fprintf fopen fread sprintf remove */
+#include <string.h> /* strlen strstr */
+
+/* These are in the working directory. */
+static const char *const in_fn = "TestDocOnlyIn.c",
+	*const out_fn = "TestDocOnlyOut", *const err_fn = "TestDocOnlyErr";
+
+/* Documentation, and what looks like it, in code that `-D` skips. */
+static const char *const input = "/** Test of `--doc-only`. */\n"
+	"\n"
+	"static int skipped(int x) {\n"
+	"\t/** Documentation in an undocumented function. */\n"
+	"\tif(x) { return 1; }\n"
+	"\treturn 0;\n"
+	"}\n"
+	"\n"
+	"static const char *const opens = \"/**\"; /* /** in a comment. */\n"
+	"\n"
+	"/** Is seen. @return Zero. */\n"
+	"int seen(void) { return 0; }\n";
+
+/** Reads `fn` into `text`. @return Success. */
+static int read_file(const char *const fn, char **const text) {
+	FILE *fp;
+	long len;
+	int success = 0;
+	if(!(fp = fopen(fn, "rb"))) return 0;
+	if(fseek(fp, 0, SEEK_END) || (len = ftell(fp)) < 0
+		|| fseek(fp, 0, SEEK_SET)) goto finally;
+	if(!(*text = malloc((size_t)len + 1))) goto finally;
+	if(fread(*text, 1, (size_t)len, fp) != (size_t)len) goto finally;
+	(*text)[len] = '\0';
+	success = 1;
+finally:
+	fclose(fp);
+	return success;
+}
+
+/** Documents the input with `cdoc` and `options`, which must be short.
+ @return Whether it worked and the documented function is in the output. */
+static int test(const char *const cdoc, const char *const options) {
+	char command[1024], *out = 0, *err = 0;
+	int success = 0;
+	if(strlen(cdoc) > 512) return fprintf(stderr, "%s: too long.\n", cdoc), 0;
+	sprintf(command, "%.512s %.32s -f md -o %s %s 2> %s", cdoc, options,
+		out_fn, in_fn, err_fn);
+	if(system(command)) {
+		fprintf(stderr, "%s: failed", command);
+		if(read_file(err_fn, &err)) fprintf(stderr, ": \"%s\"", err);
+		fprintf(stderr, ".\n");
+		goto finally;
+	}
+	if(!read_file(out_fn, &out)) { perror(out_fn); goto finally; }
+	if(!strstr(out, "seen")) {
+		fprintf(stderr, "%s: no documented function.\n", command);
+		goto finally;
+	}
+	printf("\"%s\": okay.\n", options);
+	success = 1;
+finally:
+	free(out), free(err);
+	return success;
+}
+
+/** Tests that `-D` accepts what it skips the same as without it.
+ @param[argv] Optionally, the `cdoc` to run; otherwise, `bin/cdoc`. */
+int main(int argc, char **argv) {
+	const char *const cdoc = argc > 1 ? argv[1] : "bin/cdoc";
+	FILE *fp;
+	int success = 0;
+	if(!(fp = fopen(in_fn, "w"))) { perror(in_fn); goto finally; }
+	fputs(input, fp);
+	if(fclose(fp)) { perror(in_fn); goto finally; }
+	success = test(cdoc, "") && test(cdoc, "-D");
+finally:
+	remove(in_fn), remove(out_fn), remove(err_fn);
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
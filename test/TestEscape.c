@@ -0,0 +1,135 @@
+#include <stdlib.h> /* EXIT malloc free rand */
+#include <stdio.h>  /* printf fprintf fopen fread */
+#include <string.h> /* strlen memcpy */
+#include <assert.h> /* assert */
+#include <time.h>   /* clock */
+#include "../src/Escape.h"
+
+/* What `Style.c` did before there were kernels. */
+static size_t reference(const enum EscapeSet set, const char *const from,
+	const size_t length) {
+	size_t i;
+	for(i = 0; i < length; i++) {
+		switch(from[i]) {
+		case '\0': return i;
+		case '<': case '>': case '&': if(set == ESCAPE_HTML) return i; break;
+		case '\\': case '`': case '*': case '_': case '{': case '}': case '[':
+		case ']': case '(': case ')': case '#': case '+': case '-': case '.':
+		case '!': if(set == ESCAPE_MD) return i; break;
+		default: break;
+		}
+	}
+	return i;
+}
+
+static const char *const kernels[] = { "scalar", "sse2", "avx2" };
+static const char *const sets[] = { "html", "md" };
+
+/** Every byte in every position of a clean run, and random strings.
+ @return Success. */
+static int test(void) {
+	char a[97];
+	enum EscapeKernel k;
+	enum EscapeSet s;
+	size_t i, j, n;
+	for(k = ESCAPE_SCALAR; k <= ESCAPE_AVX2; k++) {
+		if(!EscapeHasKernel(k)) { printf("%s: not available.\n", kernels[k]);
+			continue; }
+		for(s = ESCAPE_HTML; s <= ESCAPE_MD; s++) {
+			for(i = 0; i < 256; i++) for(j = 0; j < sizeof a; j++) {
+				memset(a, 'a', sizeof a);
+				a[j] = (char)i;
+				for(n = 0; n <= sizeof a; n += 1 + (n >= 8) * 7) {
+					if(EscapeSpanKernel(k, s, a, n) == reference(s, a, n))
+						continue;
+					fprintf(stderr, "%s %s: byte 0x%lx at %lu of %lu.\n",
+						kernels[k], sets[s], (unsigned long)i, (unsigned long)j,
+						(unsigned long)n);
+					return 0;
+				}
+			}
+			for(i = 0; i < 100000; i++) {
+				for(j = 0; j < sizeof a; j++) a[j] = (char)(' ' + rand() % 95);
+				n = (size_t)rand() % (sizeof a + 1);
+				if(EscapeSpanKernel(k, s, a, n) == reference(s, a, n)) continue;
+				fprintf(stderr, "%s %s: \"%.*s\".\n", kernels[k], sets[s],
+					(int)n, a);
+				return 0;
+			}
+		}
+		printf("%s: okay.\n", kernels[k]);
+	}
+	return 1;
+}
+
+/* A paragraph like one would find in the documentation. */
+static const char *const paragraph = "Sets `a` to be empty. That is, the "
+	"size of `a` will be zero, but if it was previously in an active non-idle "
+	"state, it continues to be. Compare <fn:<T>Array_>. @param[a] If null, "
+	"does nothing. @order \\Theta(1) @allow\n"
+	"Amortised \\O(`reserve`). @throws[realloc] See [IEEE Std 1003.1-2001]"
+	"(https://pubs.opengroup.org/onlinepubs/009695399/functions/realloc.html)"
+	" for details; the size is at least `size + reserve` & the capacity is a "
+	"Fibonacci number, so it grows by about 1.6 each time it is full.\n";
+
+/** Splits `text` into spans, the way `Style.c` does, with every kernel. */
+static void benchmark(const char *const text, const size_t size) {
+	enum EscapeKernel k;
+	enum EscapeSet s;
+	for(k = ESCAPE_SCALAR; k <= ESCAPE_AVX2; k++) {
+		if(!EscapeHasKernel(k)) continue;
+		for(s = ESCAPE_HTML; s <= ESCAPE_MD; s++) {
+			const clock_t start = clock();
+			size_t i, spans, repeat;
+			double seconds;
+			for(repeat = 0; repeat < 10; repeat++)
+				for(spans = 0, i = 0; i < size; spans++)
+					i += EscapeSpanKernel(k, s, text + i, size - i) + 1;
+			seconds = (double)(clock() - start) / CLOCKS_PER_SEC / 10.0;
+			printf("%s %s: %lu spans, %.1f MB/s.\n", kernels[k], sets[s],
+				(unsigned long)spans, seconds > 0.0
+				? (double)size / seconds / 1e6 : 0.0);
+		}
+	}
+}
+
+/** Reads `fn` into `text`. @return Success. */
+static int read_file(const char *const fn, char **const text,
+	size_t *const size) {
+	FILE *fp;
+	long len;
+	int success = 0;
+	if(!(fp = fopen(fn, "rb"))) return 0;
+	if(fseek(fp, 0, SEEK_END) || (len = ftell(fp)) < 0
+		|| fseek(fp, 0, SEEK_SET)) goto finally;
+	if(!(*text = malloc((size_t)len + 1))) goto finally;
+	if(fread(*text, 1, (size_t)len, fp) != (size_t)len) goto finally;
+	*size = (size_t)len;
+	success = 1;
+finally:
+	fclose(fp);
+	return success;
+}
+
+/** Tests all the kernels against the original `switch`, then times them.
+ @param[argv] Optionally, a file of documentation text to time; otherwise, a
+ representative paragraph is repeated. */
+int main(int argc, char **argv) {
+	char *text = 0;
+	size_t size = 0, p_len = strlen(paragraph), i;
+	int success = 0;
+	if(!test()) goto finally;
+	if(argc > 1) {
+		if(!read_file(argv[1], &text, &size)) { perror(argv[1]);
+			goto finally; }
+	} else {
+		size = p_len * 40000;
+		if(!(text = malloc(size))) { perror("text"); goto finally; }
+		for(i = 0; i < size; i += p_len) memcpy(text + i, paragraph, p_len);
+	}
+	benchmark(text, size);
+	success = 1;
+finally:
+	free(text);
+	return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}